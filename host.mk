@@ -0,0 +1,109 @@
+# Host-native build of firmware for benchmarking on Linux.
+# AVR headers are replaced with ones from inc/host, which route register
+# access to simulated register file, ENC28J60 and Amiga peer.
+
+# Makefile's name
+HERE := $(lastword $(MAKEFILE_LIST))
+
+OUTPUT_DIR = bin/host/
+OUTPUT_NAME = plipHost
+SRC_DIR = src/main/
+HOST_DIR = src/host/
+OBJ_DIR = obj/host/
+INC_DIR = inc
+
+# Stock board leaves ENC28J60's ~INT unconnected. ETH_INT=1 builds separate
+# variant with it patched to SD_LOCK pin.
+ifeq ($(ETH_INT),1)
+OUTPUT_NAME = plipHostInt
+OBJ_DIR = obj/host_int/
+ETH_INT_FLAGS = -DETH_INT_ON_SD_LOCK
+endif
+
+OUT = $(OUTPUT_DIR)$(OUTPUT_NAME)
+
+# Fuses and UART have no host counterparts
+MAIN_SRCS = $(filter-out $(SRC_DIR)fuse.c, $(wildcard $(SRC_DIR)*.c))
+NET_SRCS = $(wildcard $(SRC_DIR)net/*.c)
+BASE_SRCS = $(filter-out $(SRC_DIR)base/uart.c $(SRC_DIR)base/uartutil.c, \
+	$(wildcard $(SRC_DIR)base/*.c))
+SPI_SRCS = $(wildcard $(SRC_DIR)spi/*.c)
+HOST_SRCS = $(wildcard $(HOST_DIR)*.c)
+
+MAIN_OBJS = $(addprefix $(OBJ_DIR)fw_, $(notdir $(MAIN_SRCS:.c=.o)))
+NET_OBJS = $(addprefix $(OBJ_DIR)net_, $(notdir $(NET_SRCS:.c=.o)))
+BASE_OBJS = $(addprefix $(OBJ_DIR)base_, $(notdir $(BASE_SRCS:.c=.o)))
+SPI_OBJS = $(addprefix $(OBJ_DIR)spi_, $(notdir $(SPI_SRCS:.c=.o)))
+HOST_OBJS = $(addprefix $(OBJ_DIR)host_, $(notdir $(HOST_SRCS:.c=.o)))
+
+OBJS = $(MAIN_OBJS) $(NET_OBJS) $(BASE_OBJS) $(SPI_OBJS) $(HOST_OBJS)
+
+CC = gcc
+CC_FLAGS_COMMON = -std=c11 -Wall -Werror -Wstrict-prototypes \
+	-Wno-pointer-to-int-cast
+CC_FLAGS = -O2 -fno-common -I$(INC_DIR)/host -I$(INC_DIR) $(CC_FLAGS_COMMON)
+
+CC_FLAGS += $(ETH_INT_FLAGS)
+
+# Firmware calls measured by bench stage counters
+COMMA := ,
+WRAPPED = pb_proto_handle enc28j60_has_recv enc28j60_recv enc28j60_send \
+	enc28j60_recv_stream_begin enc28j60_recv_stream_end \
+	enc28j60_send_stream_begin enc28j60_send_stream_end \
+	enc28j60_send_stream_commit
+LINK_FLAGS = $(addprefix -Wl$(COMMA)--wrap=, $(WRAPPED))
+
+$(OUT): $(OBJS)
+	@echo Linking: $@
+	@mkdir -p $(OUTPUT_DIR)
+	@$(CC) -o "$@" $(OBJS) $(LINK_FLAGS)
+
+all: clean $(OUT)
+
+clean:
+	@$(RM) $(OBJ_DIR)*.o $(OUT)
+
+bench: $(OUT)
+	@$(OUT) -s rx
+	@$(OUT) -s tx
+
+# Faults while TX ring is full, run must end with every frame accounted for
+check: $(OUT)
+	@$(OUT) -s tx -n 200 -a 2 -w 4 -e 1 > /dev/null
+	@$(OUT) -s tx -n 200 -a 3 -w 4 -e 3 > /dev/null
+	@$(OUT) -s mix -n 200 -a 2 -w 4 -e 2 -l 60 -x 7 > /dev/null
+	@$(OUT) -s tx -n 200 -a 2 -w 4 -j 50 > /dev/null
+	@echo Checks passed
+
+.PHONY: all clean bench check
+
+# Firmware's main() is called by host's one
+$(OBJ_DIR)fw_main.o: $(SRC_DIR)main.c
+	@echo Building file: $<
+	@mkdir -p $(OBJ_DIR)
+	@$(CC) $(CC_FLAGS) -Dmain=firmwareMain -c -o "$@" "$<"
+
+$(OBJ_DIR)fw_%.o: $(SRC_DIR)%.c
+	@echo Building file: $<
+	@mkdir -p $(OBJ_DIR)
+	@$(CC) $(CC_FLAGS) -c -o "$@" "$<"
+
+$(OBJ_DIR)net_%.o: $(SRC_DIR)net/%.c
+	@echo Building file: $<
+	@mkdir -p $(OBJ_DIR)
+	@$(CC) $(CC_FLAGS) -c -o "$@" "$<"
+
+$(OBJ_DIR)base_%.o: $(SRC_DIR)base/%.c
+	@echo Building file: $<
+	@mkdir -p $(OBJ_DIR)
+	@$(CC) $(CC_FLAGS) -c -o "$@" "$<"
+
+$(OBJ_DIR)spi_%.o: $(SRC_DIR)spi/%.c
+	@echo Building file: $<
+	@mkdir -p $(OBJ_DIR)
+	@$(CC) $(CC_FLAGS) -c -o "$@" "$<"
+
+$(OBJ_DIR)host_%.o: $(HOST_DIR)%.c
+	@echo Building file: $<
+	@mkdir -p $(OBJ_DIR)
+	@$(CC) $(CC_FLAGS) -c -o "$@" "$<"
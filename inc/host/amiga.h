@@ -0,0 +1,56 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_AMIGA_H
+#define HOST_AMIGA_H
+
+#include <stdint.h>
+
+/**
+ * Scripted Amiga parallel port peer.
+ * Plays Amiga side of plipbox protocol, as done by Amiga's device driver:
+ * sends queued frames and fetches frames from AVR after each NACK pulse.
+ * All timings are expressed in AVR cycles.
+ */
+
+typedef struct _tAmigaTiming {
+	uint16_t uwReact;     ///< Delay between seeing BUSY edge and next action.
+	uint16_t uwBurstStep; ///< Delay between POUT toggles in burst loops.
+} tAmigaTiming;
+
+typedef struct _tAmigaStats {
+	uint32_t ulTxFrames;  ///< Frames sent to AVR.
+	uint32_t ulRxFrames;  ///< Frames received from AVR.
+	uint32_t ulRxMagic;   ///< Magic frames received from AVR.
+	uint32_t ulTimeouts;  ///< Transfers aborted due to lack of BUSY response.
+	uint64_t ullTxBytes;
+	uint64_t ullRxBytes;
+} tAmigaStats;
+
+extern tAmigaStats g_sAmigaStats;
+
+void amigaInit(const tAmigaTiming *pTiming, uint8_t ubBurst);
+
+/// Advances peer's state machine up to current virtual time.
+void amigaTick(void);
+
+/// Returns PAR_POUT, PAR_SEL and PAR_NSTROBE bits as seen on AVR's PINC.
+uint8_t amigaGetStatusLines(void);
+
+/// Returns 1 and fills pData if Amiga drives data lines.
+uint8_t amigaGetDataLines(uint8_t *pData);
+
+/// Passes AVR-driven line state: PAR_BUSY/PAR_NACK from PORTC and data lines.
+void amigaSetAvrLines(uint8_t ubStatus, uint8_t ubData, uint8_t ubDataDdr);
+
+/// Applies PBPROTO_FLAG_* accepted by AVR in its online magic packet.
+void amigaSetProtoFlags(uint16_t uwFlags);
+
+/// Returns 1 if peer is between transfers and has nothing more to do.
+uint8_t amigaIsIdle(void);
+
+#endif // HOST_AMIGA_H
@@ -0,0 +1,15 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_AVR_CPUFUNC_H
+#define HOST_AVR_CPUFUNC_H
+
+#include <host/hal.h>
+
+#define _NOP() halIdle()
+
+#endif // HOST_AVR_CPUFUNC_H
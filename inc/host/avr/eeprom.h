@@ -0,0 +1,41 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_AVR_EEPROM_H
+#define HOST_AVR_EEPROM_H
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * EEMEM variables are ordinary zero-initialized variables on host, so they
+ * act as blank EEPROM cells - config load fails its CRC check and defaults
+ * are used, just like on freshly flashed board.
+ */
+#define EEMEM
+
+static inline uint8_t eeprom_is_ready(void) {
+	return 1;
+}
+
+static inline void eeprom_read_block(void *pDst, const void *pSrc, size_t n) {
+	memcpy(pDst, pSrc, n);
+}
+
+static inline void eeprom_write_block(const void *pSrc, void *pDst, size_t n) {
+	memcpy(pDst, pSrc, n);
+}
+
+static inline uint16_t eeprom_read_word(const uint16_t *pAddr) {
+	return *pAddr;
+}
+
+static inline void eeprom_write_word(uint16_t *pAddr, uint16_t uwValue) {
+	*pAddr = uwValue;
+}
+
+#endif // HOST_AVR_EEPROM_H
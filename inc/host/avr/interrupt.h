@@ -0,0 +1,30 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+#include <host/hal.h>
+
+#define cli() halCli()
+#define sei() halSei()
+
+/**
+ * Interrupt vectors are plain functions on host, called by HAL when
+ * simulated interrupt source fires and global interrupts are enabled.
+ */
+#define ISR(vector) void vector(void)
+
+#define TIMER1_COMPA_vect halVectTimer1CompA
+#define INT0_vect         halVectInt0
+#define INT1_vect         halVectInt1
+#define PCINT0_vect       halVectPcInt0
+
+void halVectTimer1CompA(void);
+
+#endif // HOST_AVR_INTERRUPT_H
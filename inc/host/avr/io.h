@@ -0,0 +1,148 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+/**
+ * Host replacement of avr-libc's <avr/io.h> for ATmega328P.
+ * Only registers & bits used by firmware are defined.
+ */
+
+#include <stdint.h>
+#include <host/hal.h>
+
+#define _BV(bit) (1 << (bit))
+
+#define _HAL_REG8(x)  (*halReg8(HAL_ ## x))
+#define _HAL_REG16(x) (*halReg16(HAL_ ## x))
+
+// Ports
+#define PINB   _HAL_REG8(PINB)
+#define DDRB   _HAL_REG8(DDRB)
+#define PORTB  _HAL_REG8(PORTB)
+#define PINC   _HAL_REG8(PINC)
+#define DDRC   _HAL_REG8(DDRC)
+#define PORTC  _HAL_REG8(PORTC)
+#define PIND   _HAL_REG8(PIND)
+#define DDRD   _HAL_REG8(DDRD)
+#define PORTD  _HAL_REG8(PORTD)
+
+#define PB0 0
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB4 4
+#define PB5 5
+#define PB6 6
+#define PB7 7
+
+#define PC0 0
+#define PC1 1
+#define PC2 2
+#define PC3 3
+#define PC4 4
+#define PC5 5
+#define PC6 6
+
+#define PD0 0
+#define PD1 1
+#define PD2 2
+#define PD3 3
+#define PD4 4
+#define PD5 5
+#define PD6 6
+#define PD7 7
+
+// SPI
+#define SPCR   _HAL_REG8(SPCR)
+#define SPSR   _HAL_REG8(SPSR)
+#define SPDR   _HAL_REG8(SPDR)
+
+#define SPR0  0
+#define SPR1  1
+#define CPHA  2
+#define CPOL  3
+#define MSTR  4
+#define DORD  5
+#define SPE   6
+#define SPIE  7
+
+#define SPI2X 0
+#define WCOL  6
+#define SPIF  7
+
+// Timer 1
+#define TCCR1A _HAL_REG8(TCCR1A)
+#define TCCR1B _HAL_REG8(TCCR1B)
+#define TIMSK1 _HAL_REG8(TIMSK1)
+#define TIFR1  _HAL_REG8(TIFR1)
+#define TCNT1  _HAL_REG16(TCNT1)
+#define OCR1A  _HAL_REG16(OCR1A)
+
+#define WGM10  0
+#define WGM11  1
+#define WGM12  3
+#define WGM13  4
+#define CS10   0
+#define CS11   1
+#define CS12   2
+#define TOIE1  0
+#define OCIE1A 1
+#define OCIE1B 2
+#define TOV1   0
+#define OCF1A  1
+
+// External & pin change interrupts
+#define EICRA  _HAL_REG8(EICRA)
+#define EIMSK  _HAL_REG8(EIMSK)
+#define EIFR   _HAL_REG8(EIFR)
+#define PCICR  _HAL_REG8(PCICR)
+#define PCIFR  _HAL_REG8(PCIFR)
+#define PCMSK0 _HAL_REG8(PCMSK0)
+#define PCMSK1 _HAL_REG8(PCMSK1)
+#define PCMSK2 _HAL_REG8(PCMSK2)
+
+#define ISC00  0
+#define ISC01  1
+#define ISC10  2
+#define ISC11  3
+#define INT0   0
+#define INT1   1
+#define INTF0  0
+#define INTF1  1
+#define PCIE0  0
+#define PCIE1  1
+#define PCIE2  2
+#define PCIF0  0
+#define PCIF1  1
+#define PCIF2  2
+
+#define PCINT0  0
+#define PCINT1  1
+#define PCINT2  2
+#define PCINT3  3
+#define PCINT4  4
+#define PCINT5  5
+#define PCINT6  6
+#define PCINT7  7
+
+// System
+#define MCUSR  _HAL_REG8(MCUSR)
+#define WDTCSR _HAL_REG8(WDTCSR)
+#define SP     _HAL_REG16(SP)
+
+#define WDP0   0
+#define WDP1   1
+#define WDP2   2
+#define WDE    3
+#define WDCE   4
+#define WDP3   5
+#define WDIE   6
+#define WDIF   7
+
+#endif // HOST_AVR_IO_H
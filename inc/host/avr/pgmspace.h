@@ -0,0 +1,23 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+#include <stdint.h>
+
+// Host has single address space, so flash data lives in regular RAM
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte_near(addr) (*(const uint8_t *)(addr))
+#define pgm_read_byte(addr) pgm_read_byte_near(addr)
+#define pgm_read_word_near(addr) (*(const uint16_t *)(addr))
+#define pgm_read_word(addr) pgm_read_word_near(addr)
+
+#endif // HOST_AVR_PGMSPACE_H
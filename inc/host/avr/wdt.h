@@ -0,0 +1,22 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_AVR_WDT_H
+#define HOST_AVR_WDT_H
+
+#include <host/hal.h>
+
+#define WDTO_15MS   0
+#define WDTO_250MS  4
+#define WDTO_1S     6
+
+#define wdt_reset()
+
+// Watchdog reset ends firmware run
+#define wdt_enable(timeout) halExit()
+
+#endif // HOST_AVR_WDT_H
@@ -0,0 +1,106 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_BENCH_H
+#define HOST_BENCH_H
+
+#include <stdint.h>
+
+/**
+ * Benchmark scenario glue between simulated peers.
+ * Wire side injects UDP frames into ENC28J60 model at 10Mbit pace, Amiga side
+ * sends its own ones through parallel port. Both ends verify payload
+ * of frames which made it through the bridge.
+ */
+
+/// Scenario flags
+#define BENCH_RX 1 ///< Wire -> ENC28J60 -> AVR -> Amiga
+#define BENCH_TX 2 ///< Amiga -> AVR -> ENC28J60 -> wire
+
+/// Firmware stages measured by call wrappers
+#define BENCH_STAGE_PAR_IDLE 0 ///< pb_proto_handle() with nothing to do
+#define BENCH_STAGE_PAR_RX   1 ///< Parallel transfer to Amiga
+#define BENCH_STAGE_PAR_TX   2 ///< Parallel transfer from Amiga
+#define BENCH_STAGE_ENC_POLL 3 ///< enc28j60_has_recv()
+#define BENCH_STAGE_ENC_RX   4 ///< enc28j60_recv()
+#define BENCH_STAGE_ENC_TX   5 ///< enc28j60_send()
+/// Setup and finish of frames streamed during parallel transfer, per frame.
+/// Bytes are clocked by burst loops, so their cost stays in par rx/tx.
+#define BENCH_STAGE_ENC_RX_STREAM 6 ///< enc28j60_recv_stream_begin/end()
+#define BENCH_STAGE_ENC_TX_STREAM 7 ///< enc28j60_send_stream_begin/end/commit()
+#define BENCH_STAGE_COUNT    8
+
+typedef struct _tBenchConfig {
+	uint8_t ubScenario;     ///< Combination of BENCH_RX and BENCH_TX.
+	uint32_t ulFrames;      ///< Frame count in each direction.
+	uint16_t uwFrameSize;   ///< Ethernet frame size without CRC.
+	uint32_t ulWireGap;     ///< Cycles between wire frames, 0 for 10Mbit pace.
+	uint32_t ulTimeLimitMs; ///< Virtual time limit.
+	uint16_t uwProtoFlags;  ///< PBPROTO_FLAG_* offered when going online.
+	uint16_t uwNoiseEvery;  ///< Unwanted bcast/mcast frame after every n wire ones.
+	uint8_t ubFilter;       ///< Amiga loads ENC28J60 filter after going online.
+	uint16_t uwBadCsumEvery; ///< Frame with broken UDP checksum after every n wire ones.
+	uint16_t uwTxFaultEvery; ///< Every n-th transmission ends with late collision.
+	uint16_t uwTxStuckNth;   ///< N-th transmission never ends, 0 for none.
+	uint8_t ubTxSlowdown;    ///< Transmissions take n times longer, 0 same as 1.
+	uint16_t uwRxFaultEvery; ///< Every n-th stored frame gets broken RX header.
+	uint8_t ubTxSlots;       ///< ENC28J60 TX slots stored in EEPROM, 0 for none.
+	uint16_t uwLinkFlapMs;   ///< Link goes down for a while every n ms, 0 never.
+	uint16_t uwArpEvery;     ///< ARP request for Amiga's IP after every n wire frames.
+	uint16_t uwEchoEvery;    ///< Ping of Amiga's IP after every n wire frames.
+} tBenchConfig;
+
+typedef struct _tBenchStage {
+	uint32_t ulCalls;
+	uint64_t ullCycles; ///< Exclusive - nested stages are not included.
+	uint64_t ullBytes;
+} tBenchStage;
+
+typedef struct _tBenchStats {
+	uint32_t ulRxInjected; ///< Frames put into ENC28J60 RX path.
+	uint32_t ulRxOk;       ///< Frames received intact by Amiga.
+	uint32_t ulRxBad;
+	uint32_t ulTxOk;       ///< Frames put intact on the wire.
+	uint32_t ulTxBad;
+	uint32_t ulNoiseInjected; ///< Frames Amiga's stack doesn't want.
+	uint32_t ulNoiseRx;       ///< Unwanted frames which reached Amiga anyway.
+	uint32_t ulBadCsumInjected; ///< Frames with broken UDP checksum.
+	uint32_t ulBadCsumRx;       ///< Broken frames which reached Amiga.
+	uint32_t ulLinkFlaps;       ///< Link losses done by bench.
+	uint32_t ulLinkEvents;      ///< Link magic packets received by Amiga.
+	uint32_t ulArpInjected;     ///< ARP requests for Amiga's IP.
+	uint32_t ulArpRx;           ///< ARP requests which reached Amiga.
+	uint32_t ulArpReplies;      ///< Correct ARP replies put on the wire.
+	uint32_t ulEchoInjected;    ///< ICMP echo requests for Amiga's IP.
+	uint32_t ulEchoRx;          ///< Echo requests which reached Amiga.
+	uint32_t ulEchoReplies;     ///< Correct echo replies put on the wire.
+	uint32_t ulNeighRequests;   ///< ARP requests for remote host made by AVR.
+	uint32_t ulHdrcRx;          ///< Frames which reached Amiga compressed.
+	uint64_t ullPayloadBytes;  ///< Frame bytes of all intact frames.
+	uint64_t ullStartCycles;   ///< Time at which Amiga went online.
+	uint64_t ullEndCycles;
+	uint8_t ubTimedOut;
+	tBenchStage pStages[BENCH_STAGE_COUNT];
+} tBenchStats;
+
+extern tBenchStats g_sBenchStats;
+
+void benchInit(const tBenchConfig *pConfig);
+
+/// Drives scenario: wire traffic generation and end-of-run detection.
+void benchTick(void);
+
+/// Fills next frame Amiga should send. Returns 0 if there's nothing to send.
+uint8_t benchGetAmigaFrame(uint8_t *pBuf, uint16_t *pSize);
+
+/// Called by Amiga peer on each frame fetched from AVR.
+void benchOnAmigaFrame(const uint8_t *pData, uint16_t uwSize);
+
+/// Called by ENC28J60 model on each frame put on the wire.
+void benchOnWireFrame(const uint8_t *pData, uint16_t uwSize);
+
+#endif // HOST_BENCH_H
@@ -0,0 +1,75 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_ENCSIM_H
+#define HOST_ENCSIM_H
+
+#include <stdint.h>
+
+/**
+ * Behavioural ENC28J60 model sitting on simulated SPI bus.
+ * Implements SPI opcodes, register banks, buffer memory with RX ring and
+ * pointer auto-increment, PHY access via MII registers and its link change
+ * interrupt, DMA checksums and copies and 10Mbit wire timing of transmitted
+ * frames.
+ */
+
+typedef struct _tEncsimStats {
+	uint32_t ulRxFrames;    ///< Frames stored in RX ring.
+	uint32_t ulRxOverflows; ///< Frames lost due to full RX ring.
+	uint32_t ulRxFiltered;  ///< Frames rejected by receive filters.
+	uint32_t ulRxMissed;    ///< Frames which came while RX or link was down.
+	uint32_t ulTxFrames;    ///< Frames put on the wire.
+	uint32_t ulTxAborted;   ///< Frames aborted by injected late collisions.
+	uint32_t ulTxStuck;     ///< Transmissions which were made to never end.
+	uint32_t ulTxNoLink;    ///< Frames sent while link was down.
+	uint64_t ullTxBytes;
+	uint16_t uwRxPeak;      ///< Highest number of RX ring bytes in use.
+	uint32_t ulDmaRuns;     ///< DMA checksum calculations and copies.
+} tEncsimStats;
+
+extern tEncsimStats g_sEncsimStats;
+
+void encsimInit(void);
+
+/// Sets state of chip select line.
+void encsimSelect(uint8_t ubSelected);
+
+/// Exchanges one byte on SPI bus, returns byte shifted out by chip.
+uint8_t encsimSpiXfer(uint8_t ubMosi);
+
+/// Aborts every n-th transmission with late collision, 0 disables it.
+void encsimSetTxFaults(uint16_t uwEvery);
+
+/// Makes n-th transmission never end until TX reset, 0 disables it.
+void encsimSetTxStuck(uint16_t uwNth);
+
+/// Makes transmissions take n times longer than at 10Mbit, e.g. on busy wire.
+void encsimSetTxSlowdown(uint8_t ubTimes);
+
+/// Breaks RX header of every n-th stored frame, 0 disables it.
+void encsimSetRxFaults(uint16_t uwEvery);
+
+/// Advances transmit and DMA state machines up to current virtual time.
+void encsimTick(void);
+
+/// Returns 1 when INT line is asserted (active low on real chip).
+uint8_t encsimIsIntActive(void);
+
+/// Puts frame coming from the wire into RX ring. Returns 1 if accepted.
+uint8_t encsimInjectFrame(const uint8_t *pData, uint16_t uwSize);
+
+/// Returns number of frames waiting in RX ring.
+uint8_t encsimGetPktCnt(void);
+
+/// Returns 1 if transmit logic is busy with a frame.
+uint8_t encsimIsTxBusy(void);
+
+/// Changes PHY link state.
+void encsimSetLink(uint8_t ubUp);
+
+#endif // HOST_ENCSIM_H
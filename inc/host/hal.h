@@ -0,0 +1,98 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <stdint.h>
+#include <setjmp.h>
+
+/**
+ * Host-side register file.
+ * Firmware sources access AVR registers through macros defined in
+ * inc/host/avr/io.h, which expand to halReg8()/halReg16() calls. Each access
+ * advances virtual clock, lets simulated peripherals react on previous write
+ * and refreshes input registers before firmware reads them.
+ */
+
+/// 8-bit registers
+#define HAL_PINB     0
+#define HAL_DDRB     1
+#define HAL_PORTB    2
+#define HAL_PINC     3
+#define HAL_DDRC     4
+#define HAL_PORTC    5
+#define HAL_PIND     6
+#define HAL_DDRD     7
+#define HAL_PORTD    8
+#define HAL_SPCR     9
+#define HAL_SPSR    10
+#define HAL_SPDR    11
+#define HAL_TCCR1A  12
+#define HAL_TCCR1B  13
+#define HAL_TIMSK1  14
+#define HAL_TIFR1   15
+#define HAL_MCUSR   16
+#define HAL_WDTCSR  17
+#define HAL_EICRA   18
+#define HAL_EIMSK   19
+#define HAL_EIFR    20
+#define HAL_PCICR   21
+#define HAL_PCIFR   22
+#define HAL_PCMSK0  23
+#define HAL_PCMSK1  24
+#define HAL_PCMSK2  25
+#define HAL_REG8_COUNT 26
+
+/// 16-bit registers
+#define HAL_TCNT1    0
+#define HAL_OCR1A    1
+#define HAL_SP       2
+#define HAL_REG16_COUNT 3
+
+/// Estimated cycles of single register access, including load/test/branch
+/// instructions of typical polling loop around it.
+#define HAL_ACCESS_CYCLES 4
+/// Cycles of ISR entry & exit (vector jump, prologue, epilogue, reti).
+#define HAL_ISR_CYCLES 40
+/// SPI is clocked at F_CPU/2, so each byte takes 16 cycles to shift.
+#define HAL_SPI_BYTE_CYCLES 16
+
+typedef struct _tHalStats {
+	uint64_t ullAccessCount; ///< Number of register accesses.
+	uint64_t ullSpiBytes;    ///< Bytes shifted through SPI while ETH_CS low.
+	uint32_t ulSpiSelects;   ///< ETH_CS falling edges.
+	uint32_t ulIsrCount;     ///< Number of serviced interrupts.
+	uint32_t ulIrqOffMax;    ///< Longest cli()..sei() window in cycles.
+} tHalStats;
+
+extern tHalStats g_sHalStats;
+
+/// Jump target used to leave firmware's endless loop.
+extern jmp_buf g_sHalExit;
+
+void halInit(void);
+
+volatile uint8_t *halReg8(uint8_t ubReg);
+volatile uint16_t *halReg16(uint8_t ubReg);
+
+void halCli(void);
+void halSei(void);
+
+/// Burns given number of cycles without register access, e.g. delay loops.
+void halDelayCycles(uint32_t ulCycles);
+
+/// Called by firmware code which would otherwise spin without touching any
+/// register, so that virtual time and interrupts keep going.
+void halIdle(void);
+
+/// Terminates firmware run - jumps back to the point set by setjmp().
+void halExit(void) __attribute__((noreturn));
+
+uint64_t halGetCycles(void);
+
+#endif // HOST_HAL_H
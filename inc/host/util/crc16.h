@@ -0,0 +1,26 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_UTIL_CRC16_H
+#define HOST_UTIL_CRC16_H
+
+#include <stdint.h>
+
+/// C equivalent of avr-libc's optimized CRC16 (polynomial 0xA001).
+static inline uint16_t _crc16_update(uint16_t uwCrc, uint8_t ubData) {
+	uint8_t i;
+	uwCrc ^= ubData;
+	for(i = 0; i < 8; ++i) {
+		if(uwCrc & 1)
+			uwCrc = (uwCrc >> 1) ^ 0xA001;
+		else
+			uwCrc = (uwCrc >> 1);
+	}
+	return uwCrc;
+}
+
+#endif // HOST_UTIL_CRC16_H
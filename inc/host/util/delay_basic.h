@@ -0,0 +1,24 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HOST_UTIL_DELAY_BASIC_H
+#define HOST_UTIL_DELAY_BASIC_H
+
+#include <stdint.h>
+#include <host/hal.h>
+
+/// 3 cycles per iteration, 0 means 256 iterations.
+static inline void _delay_loop_1(uint8_t ubCount) {
+	halDelayCycles(3 * (ubCount ? ubCount : 256));
+}
+
+/// 4 cycles per iteration, 0 means 65536 iterations.
+static inline void _delay_loop_2(uint16_t uwCount) {
+	halDelayCycles(4 * (uwCount ? uwCount : 65536UL));
+}
+
+#endif // HOST_UTIL_DELAY_BASIC_H
@@ -11,7 +11,8 @@
 #include <main/global.h>
 
 void bridgeLoop(void);
-uint8_t bridgeFillPacket(uint16_t *pFilledSize);
-uint8_t bridgeProcessPacket(uint16_t uwSize);
+uint8_t bridgeFillPacket(uint16_t *pFilledSize, uint8_t *pStream);
+void bridgeFillNextPacket(uint16_t *pFilledSize, uint8_t ubStream);
+uint8_t bridgeProcessPacket(uint16_t uwSize, uint8_t ubStreamed);
 
 #endif
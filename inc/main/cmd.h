@@ -30,6 +30,10 @@
 #define CMD_SDINFO     5
 #define CMD_SDREAD     6
 #define CMD_SDWRITE    7
+#define CMD_SETFILTER  8
+#define CMD_GETSTATS   9
+#define CMD_SETROUTE  10
+#define CMD_SETHDRCTX 11
 #define CMD_RESPONSE 128
 
 extern void cmdProcess(uint16_t uwPacketSize);
@@ -26,6 +26,8 @@ typedef struct _tConfig {
   uint16_t test_port;
   uint8_t zzPad;
   uint8_t test_mode;
+  uint8_t burst_delay; ///< RX burst delay loops until Amiga's pace is known.
+  uint8_t tx_slots;    ///< ENC28J60 TX ring slots, rest is RX buffer.
 } tConfig;
 
 extern tConfig g_sConfig;
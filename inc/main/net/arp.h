@@ -28,6 +28,7 @@
 
 extern uint8_t arp_is_ipv4(const uint8_t *buf, uint16_t len);
 extern void arp_make_reply(uint8_t *buf, const uint8_t *my_mac, const uint8_t *my_ip);
+extern void arp_make_request(uint8_t *buf, const uint8_t *my_mac, const uint8_t *my_ip, const uint8_t *tgt_ip);
 
 /* getter */
 inline uint16_t arp_get_op(const uint8_t *buf) { return net_get_word(buf + ARP_OFF_OP); }
@@ -23,7 +23,9 @@
 /**
  * Custom EtherType values.
  * ETH_TYPE_MAGIC_ONLINE:
- *   Request by Amiga to go online
+ *   Request by Amiga to go online. Amiga may append a word with offered
+ *   PBPROTO_FLAG_* bits after eth header - plipUltimate then responds with
+ *   online magic packet carrying accepted ones, see ETH_OFF_MAGIC_FLAGS.
  * ETH_TYPE_MAGIC_OFFLINE:
  *   Request by Amiga to go offline
  * ETH_TYPE_MAGIC_LOOPBACK:
@@ -31,11 +33,20 @@
  * ETH_TYPE_MAGIC_CMD:
  *   Used as non-ethernet commands, such as SD access
  *   or reboot request.
+ * ETH_TYPE_MAGIC_LINK:
+ *   Sent to Amiga if it accepted PBPROTO_FLAG_LINK_EVENTS - on going online
+ *   and on each link change. Word at ETH_OFF_MAGIC_LINK is 1 if link is up.
  */
 #define ETH_TYPE_MAGIC_ONLINE	  0xffff
 #define ETH_TYPE_MAGIC_OFFLINE  0xfffe
 #define ETH_TYPE_MAGIC_LOOPBACK 0xfffd
 #define ETH_TYPE_MAGIC_CMD      0xfffc
+#define ETH_TYPE_MAGIC_LINK     0xfffb
+
+// Protocol flags word in online magic packets
+#define ETH_OFF_MAGIC_FLAGS     ETH_HDR_SIZE
+// Link state word in link magic packets
+#define ETH_OFF_MAGIC_LINK      ETH_HDR_SIZE
 
 /**
  * Returns pointer to target MAC address in given eth frame.
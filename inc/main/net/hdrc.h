@@ -0,0 +1,42 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef HDRC_H
+#define HDRC_H
+
+#include <main/global.h>
+#include <main/net/eth.h>
+
+/**
+ * Ethernet header compression on parallel port. Amiga installs contexts,
+ * each being peer's MAC and EtherType, and frames exchanged with that peer
+ * cross the port with single tag byte instead of 14-byte header. Same context
+ * serves both directions, since other MAC is always Amiga's own one.
+ * Frame starting with tag byte is compressed one, other frames are sent as
+ * they are. Uncompressed frames which happen to start with byte looking like
+ * tag get HDRC_TAG_RAW put in front of them.
+ */
+
+#define HDRC_CTX_COUNT 8
+#define HDRC_TAG_CTX   0xF0 // tag of context 0, following ones come next
+#define HDRC_TAG_RAW   (HDRC_TAG_CTX + HDRC_CTX_COUNT)
+
+// Header room left before Amiga's frames, so that tag is overwritten by
+// expanded header's last byte
+#define HDRC_ROOM (ETH_HDR_SIZE - 1)
+
+inline uint8_t hdrc_is_tag(uint8_t byte)
+{
+  return byte >= HDRC_TAG_CTX && byte <= HDRC_TAG_RAW;
+}
+
+extern void hdrc_reset(void);
+extern uint8_t hdrc_set(uint8_t ctx, const uint8_t *mac, uint16_t type);
+extern uint8_t hdrc_find(const uint8_t *frame, const uint8_t *own_mac);
+extern uint8_t hdrc_expand(uint8_t tag, uint8_t *frame, const uint8_t *own_mac);
+
+#endif
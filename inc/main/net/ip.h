@@ -19,14 +19,25 @@
 #define IP_MIN_HDR_SIZE     20
 
 #define IP_CHECKSUM_OFF     10
+#define IP_SRC_IP_OFF       12
+#define IP_TGT_IP_OFF       16
 
 #define UDP_CHECKSUM_OFF    6
 #define TCP_CHECKSUM_OFF    16
 
-inline const uint8_t *ip_get_src_ip(const uint8_t *buf) { return buf + 12; }
-inline const uint8_t *ip_get_tgt_ip(const uint8_t *buf) { return buf + 16; }
+#define ICMP_HDR_SIZE       8
+#define ICMP_CHECKSUM_OFF   2
+
+#define ICMP_TYPE_ECHO_REPLY    0
+#define ICMP_TYPE_ECHO_REQUEST  8
+
+inline const uint8_t *ip_get_src_ip(const uint8_t *buf) { return buf + IP_SRC_IP_OFF; }
+inline const uint8_t *ip_get_tgt_ip(const uint8_t *buf) { return buf + IP_TGT_IP_OFF; }
+inline uint8_t ip_get_version(const uint8_t *buf) { return buf[0] >> 4; }
 inline uint16_t ip_get_total_length(const uint8_t *buf) { return (uint16_t)buf[2] << 8 | (uint16_t)buf[3]; }
 inline uint8_t ip_get_hdr_length(const uint8_t *buf) { return (buf[0] & 0xf) * 4; }
 inline uint8_t ip_get_protocol(const uint8_t *buf) { return buf[9]; }
+/* MF flag or non-zero fragment offset */
+inline uint8_t ip_is_fragment(const uint8_t *buf) { return (buf[6] & 0x3F) || buf[7]; }
 
 #endif
@@ -0,0 +1,28 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#ifndef NEIGH_H
+#define NEIGH_H
+
+#include <main/global.h>
+#include <main/net/net.h>
+
+/**
+ * Neighbour cache, used in IP-only mode to put Ethernet headers in front of
+ * Amiga's IPv4 packets. Maps addresses of hosts on local network to their
+ * MACs, as seen in ARP traffic and received frames. Packets for other
+ * networks go to gateway, if Amiga has told which one it uses.
+ */
+
+#define NEIGH_CACHE_SIZE 4
+
+extern void neigh_reset(void);
+extern void neigh_set_route(const uint8_t *netmask, const uint8_t *gateway);
+extern void neigh_learn(const uint8_t *ip, const uint8_t *mac);
+extern uint8_t neigh_resolve(const uint8_t *tgt_ip, uint8_t *mac, uint8_t *hop);
+
+#endif
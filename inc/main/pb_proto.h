@@ -28,12 +28,46 @@
 #define PBPROTO_STAGE_BURST_LO           0x60
 #define PBPROTO_STAGE_BURST_HI           0x70
 #define PBPROTO_STAGE_INPUT              0x80
+#define PBPROTO_STAGE_BATCH_NEXT         0x90
 
 // commands
 #define PBPROTO_CMD_SEND       0x11   // amiga wants to send a packet
 #define PBPROTO_CMD_RECV       0x22   // amiga wants to receive a packet
 #define PBPROTO_CMD_SEND_BURST 0x33
 #define PBPROTO_CMD_RECV_BURST 0x44
+#define PBPROTO_CMD_RECV_BATCH 0x55   // many frames in one recv_burst-like cycle
+#define PBPROTO_CMD_SEND_BATCH 0x66   // many frames in one send_burst-like cycle
+
+// max frames in single PBPROTO_CMD_RECV_BATCH or PBPROTO_CMD_SEND_BATCH
+#define PBPROTO_BATCH_MAX_FRAMES 8
+
+// protocol flags, negotiated with online magic packets
+#define PBPROTO_FLAG_EXACT_SIZE 0x0001 // transfer exact byte count, no padding
+                                       // (Ethernet one of IPv4/ARP included)
+#define PBPROTO_FLAG_RECV_BATCH 0x0002 // PBPROTO_CMD_RECV_BATCH is available
+#define PBPROTO_FLAG_SEND_BATCH 0x0004 // PBPROTO_CMD_SEND_BATCH is available
+#define PBPROTO_FLAG_CSUM_OFFLOAD 0x0008 // IP/TCP/UDP checksums done by ENC28J60
+#define PBPROTO_FLAG_LINK_EVENTS 0x0010 // link changes reported with magic packets
+#define PBPROTO_FLAG_ARP_OFFLOAD 0x0020 // ARP requests for Amiga's IP answered by AVR
+#define PBPROTO_FLAG_ICMP_OFFLOAD 0x0040 // pings of Amiga's IP answered by AVR
+#define PBPROTO_FLAG_IP_ONLY 0x0080 // bare IPv4 packets, Ethernet is done by AVR
+#define PBPROTO_FLAG_HDR_COMPRESS 0x0100 // Ethernet headers replaced by context tags
+#define PBPROTO_FLAGS_SUPPORTED ( \
+  PBPROTO_FLAG_EXACT_SIZE | PBPROTO_FLAG_RECV_BATCH | PBPROTO_FLAG_SEND_BATCH | \
+  PBPROTO_FLAG_CSUM_OFFLOAD | PBPROTO_FLAG_LINK_EVENTS | \
+  PBPROTO_FLAG_ARP_OFFLOAD | PBPROTO_FLAG_ICMP_OFFLOAD | PBPROTO_FLAG_IP_ONLY | \
+  PBPROTO_FLAG_HDR_COMPRESS \
+)
+
+// RX burst delay loop limits - each loop takes 3 cycles
+#if (F_CPU == 16000000)
+	#define PBPROTO_BURST_DELAY_MAX 6
+#elif (F_CPU == 20000000UL)
+	#define PBPROTO_BURST_DELAY_MAX 15
+#else
+	#error Delay loop not defined for F_CPU
+#endif
+#define PBPROTO_BURST_DELAY_MIN 1
 
 // line status
 #define PBPROTO_LINE_OFF       0x0
@@ -57,6 +91,8 @@ extern pb_proto_stat_t pb_proto_stat; // filled by pb_proto_handle()
 // ----- Parameter -----
 
 extern uint16_t pb_proto_rx_timeout; // timeout for next byte in 100us
+extern uint16_t pb_proto_flags; // PBPROTO_FLAG_* accepted from Amiga
+extern uint8_t pb_proto_headroom; // bytes left free before frames from Amiga
 
 // ----- API -----
 
@@ -64,5 +100,6 @@ extern void parInit(void);
 extern uint8_t  parGetStatusLines(void);
 extern uint8_t  pb_proto_handle(void); // side effect: fill pb_proto_stat!
 extern void parRequestAmiRead(void);
+extern void parCalibrateBurst(void);
 
 #endif
@@ -47,6 +47,14 @@
 // PB6 is used as XTAL1
 #define SD_DETECT _BV(PB7)
 
+/// ENC28J60 ~INT line - not routed on the PCB. If board is patched to have
+/// it connected to SD_LOCK pin, build with ETH_INT_ON_SD_LOCK so that idle
+/// loop checks it instead of polling EPKTCNT over SPI.
+#ifdef ETH_INT_ON_SD_LOCK
+#define ETH_INT     SD_LOCK
+#define ETH_INT_PIN PINB
+#endif
+
 #define SPI_PORT PORTB
 #define SPI_PIN  PINB
 #define SPI_DDR  DDRB
@@ -15,6 +15,7 @@
 #define PIO_NOT_FOUND     1
 #define PIO_TOO_LARGE     2
 #define PIO_IO_ERR        3
+#define PIO_DROPPED       4 // frame was fine, but got rejected on purpose
 
 /* init flags */
 #define PIO_INIT_FULL_DUPLEX    1
@@ -20,11 +20,23 @@ extern uint8_t pio_util_get_init_flags(void);
 */
 extern uint8_t pio_util_recv_packet(uint16_t *size);
 
+/* begin streaming packet straight from pio, see enc28j60_recv_stream_begin().
+   updates stats. only call if pio_has_recv() is not 0!
+   returns packet size and pio status.
+*/
+extern uint8_t pio_util_recv_stream(uint16_t *size);
+
 /* send packet to current PIO from pkt_buf
    aöso updates stats and is verbose if enabled.
    return pio status.
 */
 extern uint8_t pio_util_send_packet(uint16_t size);
 
+/* send packet already streamed into pio, see enc28j60_send_stream_begin().
+   also updates stats.
+   return pio status.
+*/
+extern uint8_t pio_util_send_streamed(uint16_t size);
+
 
 #endif
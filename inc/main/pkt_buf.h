@@ -11,7 +11,10 @@
 #include <main/global.h>
 
 #define DATABUF_SIZE    1514
+// Extra room for Ethernet header put in front of frame by AVR, or for tag
+// byte, see pb_proto_headroom
+#define DATABUF_ROOM    (14 + 1)
 
-extern uint8_t g_pDataBuffer[DATABUF_SIZE];
+extern uint8_t g_pDataBuffer[DATABUF_SIZE + DATABUF_ROOM];
 
 #endif
@@ -8,18 +8,76 @@
 #ifndef ENC28J60_H
 #define ENC28J60_H
 
+#include <main/global.h>
+
 /**
  * ENC28J60 online status.
  * 1 if ENC is set up correctly, otherwise 0
  */
 extern uint8_t g_ubEncOnline;
+extern uint8_t g_ubEncLinkUp; // PHY link state, updated by enc28j60_link_poll()
+
+/**
+ * Receive filter classes, same bits as ENC28J60's ERXFCON. In default OR mode
+ * frame is accepted if any selected filter matches it, with
+ * ENC28J60_FILTER_AND it must match all of them.
+ */
+#define ENC28J60_FILTER_BCAST   0x01 // broadcast frames
+#define ENC28J60_FILTER_MCAST   0x02 // all multicast frames
+#define ENC28J60_FILTER_HASH    0x04 // destinations with bit set in hash table
+#define ENC28J60_FILTER_MAGIC   0x08 // Wake-on-LAN magic packets to own MAC
+#define ENC28J60_FILTER_PATTERN 0x10 // frames matching pattern
+#define ENC28J60_FILTER_AND     0x40
+#define ENC28J60_FILTER_UCAST   0x80 // frames to own MAC
+
+/**
+ * Receive filter as sent by Amiga. 16-bit fields are big endian.
+ * Hash table bit is picked by bits 28:23 of destination MAC's CRC, pattern
+ * checksum is IP checksum of bytes selected by mask in 64-byte window
+ * starting pattern_offs bytes into frame - see ENC28J60 datasheet.
+ */
+typedef struct {
+  uint8_t flags;           // ENC28J60_FILTER_*
+  uint8_t pad;
+  uint8_t hash[8];         // EHT0..EHT7
+  uint8_t pattern_mask[8]; // EPMM0..EPMM7
+  uint8_t pattern_csum[2]; // EPMCS
+  uint8_t pattern_offs[2]; // EPMO
+} enc28j60_filter_t;
+
+/**
+ * TX ring slots, each taking 1.5K of ENC28J60's 8K buffer memory. More slots
+ * help Amiga sending fast, less leave more room for received frames.
+ */
+#define ENC28J60_TX_SLOTS_MIN     1
+#define ENC28J60_TX_SLOTS_MAX     4
+#define ENC28J60_TX_SLOTS_DEFAULT 2
 
-uint8_t enc28j60_init(const uint8_t macaddr[6], uint8_t flags);
+uint8_t enc28j60_init(const uint8_t macaddr[6], uint8_t flags, uint8_t tx_slots);
 void enc28j60_exit(void);
 uint8_t enc28j60_send(const uint8_t *data, uint16_t size);
+void enc28j60_send_stream_begin(uint8_t hdr_room);
+void enc28j60_send_stream_end(void);
+uint8_t enc28j60_send_stream_commit(const uint8_t *data, uint16_t size);
+uint8_t enc28j60_tx_poll(void);
+uint8_t enc28j60_link_poll(void);
 uint8_t enc28j60_recv(uint8_t *data, uint16_t max_size, uint16_t *got_size);
+uint8_t enc28j60_recv_stream_begin(uint16_t *got_size);
+void enc28j60_recv_stream_end(void);
+uint8_t enc28j60_peek(
+  uint8_t index, uint16_t offs, uint8_t *data, uint16_t len, uint16_t *got_size
+);
+uint8_t enc28j60_drop(void);
+void enc28j60_set_rx_window(uint8_t skip, uint16_t len);
+void enc28j60_set_rx_lead(uint8_t lead);
+uint8_t enc28j60_bounce(
+  const uint8_t *hdr, uint8_t hdr_len, uint16_t size,
+  uint8_t csum_start, uint8_t csum_offs
+);
 uint8_t enc28j60_has_recv(void);
 uint8_t enc28j60_status(uint8_t status_id, uint8_t *value);
 uint8_t enc28j60_control(uint8_t control_id, uint8_t value);
+void enc28j60_set_filter(const enc28j60_filter_t *filter);
+void enc28j60_set_csum_offload(uint8_t enable);
 
 #endif
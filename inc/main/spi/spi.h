@@ -25,6 +25,22 @@ static inline uint8_t spiReadByte(void) {
   return SPDR;
 }
 
+/**
+ * Reads block of bytes, one spiReadByte() at a time.
+ */
+static inline void spiReadBlock(uint8_t *pData, uint16_t uwLen) {
+  while(uwLen--)
+    *pData++ = spiReadByte();
+}
+
+/**
+ * Writes block of bytes, one spiWriteByte() at a time.
+ */
+static inline void spiWriteBlock(const uint8_t *pData, uint16_t uwLen) {
+  while(uwLen--)
+    spiWriteByte(*pData++);
+}
+
 static inline void spiEnableEth(void) {
 	SPI_PORT |= SD_CS;
 	SPI_PORT &= ~ETH_CS;
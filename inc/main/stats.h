@@ -16,6 +16,13 @@
 #define STATS_ID_PIO_TX 3
 #define STATS_ID_NUM    4
 
+/**
+ * Frames which were fine but got discarded are counted in drop:
+ *  PIO_RX - lost in ENC28J60 RX buffer overflows (one per overflow, so it's
+ *           a lower bound), discarded by RX reset or by checksum offload
+ *  PB_RX  - fetched from ENC28J60, but not delivered to Amiga
+ *  PB_TX  - sent by Amiga, but not passed to ENC28J60 since it's offline
+ */
 typedef struct {
   uint32_t bytes;
   uint16_t cnt;
@@ -26,6 +33,55 @@ typedef struct {
 
 extern stats_t stats[STATS_ID_NUM];
 
+typedef struct {
+  uint16_t stalls;    // sends which had to wait for free TX slot
+  uint16_t late_cols; // frames aborted due to late collision, also in err
+  uint16_t drops;     // frames given up on after TX got stuck, also in drop
+  uint8_t depth;      // frames queued in ENC28J60 TX ring
+  uint8_t max_depth;
+} stats_tx_queue_t;
+
+extern stats_tx_queue_t stats_tx_queue;
+
+typedef struct {
+  uint16_t overflows; // RXERIF occurrences, also in PIO_RX drop
+  uint16_t resets;    // RX logic resets after finding buffer corrupted
+  uint16_t peak_fill; // RX buffer bytes taken, sampled on each new peak_frames
+  uint8_t peak_frames; // most frames seen waiting in RX buffer
+} stats_rx_buf_t;
+
+extern stats_rx_buf_t stats_rx_buf;
+
+typedef struct {
+  uint16_t downs;     // link losses
+  uint32_t last_down; // g_uwTimeStamp of last link loss, in 100us
+  uint32_t last_up;   // g_uwTimeStamp of last link recovery, in 100us
+} stats_link_t;
+
+extern stats_link_t stats_link;
+
+// ENC28J60 SPI traffic of last frame taken from RX buffer and last one queued
+// for TX, opcodes included. Frame is charged with everything since previous
+// frame or idle poll.
+typedef struct {
+  uint16_t rx_bytes;
+  uint16_t rx_selects;
+  uint16_t tx_bytes;
+  uint16_t tx_selects;
+} stats_spi_t;
+
+extern stats_spi_t stats_spi;
+
+typedef struct {
+  uint16_t arp_replies; // ARP requests for Amiga's IP answered without Amiga
+  uint16_t echo_replies; // ICMP echo requests answered without Amiga
+  uint16_t arp_requests; // sent for next hops of Amiga's packets in IP-only mode
+  uint16_t hdrc_rx; // frames which went to Amiga with compressed header
+  uint16_t hdrc_tx; // frames which came from Amiga with compressed header
+} stats_offload_t;
+
+extern stats_offload_t stats_offload;
+
 extern void stats_reset(void);
 extern void stats_dump_all(void);
 extern void stats_dump(uint8_t pb, uint8_t pio);
@@ -35,6 +35,9 @@ typedef struct _tConfig {
   UBYTE test_ip[4];  ///< Plipbox IP? Used in ARP check.
   UWORD test_port;
   UBYTE test_mode;
+  UBYTE zzPad;
+  UBYTE burst_delay; ///< RX burst delay loops until Amiga's pace is known.
+  UBYTE tx_slots;    ///< ENC28J60 TX ring slots, rest is RX buffer.
 } tConfig;
 
 void cmdReset(void);
@@ -0,0 +1,369 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#include <host/amiga.h>
+#include <string.h>
+#include <avr/io.h>
+#include <main/global.h>
+#include <main/pinout.h>
+#include <main/pb_proto.h>
+#include <main/pkt_buf.h>
+#include <host/hal.h>
+#include <host/bench.h>
+
+/// Give up on transfer after 500ms without BUSY response
+#define AMIGA_TIMEOUT (F_CPU / 2)
+
+#define WAIT_NONE 0xFF
+
+// Transfer phases
+#define PH_IDLE        0
+#define PH_END         1
+#define PH_W_SIZE_HI   2
+#define PH_W_SIZE_LO   3
+#define PH_W_DATA      4
+#define PH_W_END1      5
+#define PH_W_END2      6
+#define PH_W_DONE      7
+#define PH_R_SIZE_HI   8
+#define PH_R_SIZE_LO   9
+#define PH_R_READY    10
+#define PH_R_DATA     11
+#define PH_R_DATA_GET 12
+#define PH_R_BURST    13
+#define PH_R_END1     14
+#define PH_R_END2     15
+#define PH_R_DONE     16
+#define PH_W_BATCH_END 17
+
+tAmigaStats g_sAmigaStats;
+
+static tAmigaTiming s_sTiming;
+static uint8_t s_ubBurst;
+static uint16_t s_uwProtoFlags;
+
+// Lines driven by Amiga
+static uint8_t s_ubPout, s_ubSel;
+static uint8_t s_ubData, s_ubDataDrive;
+
+// Lines driven by AVR
+static uint8_t s_ubBusy, s_ubNack;
+static uint8_t s_ubAvrData;
+
+static uint8_t s_ubPhase;
+static uint8_t s_ubCmd; ///< Current command.
+static uint8_t s_ubBatchFrames; ///< Frames sent in current send batch.
+static uint8_t s_ubWaitBusy;
+static uint64_t s_ullWaitStart;
+static uint64_t s_ullNextAt;
+
+static uint8_t s_ubAvrReady;  ///< Set once AVR drives NACK high.
+static uint8_t s_ubListening; ///< Set after driver went online.
+static uint8_t s_ubRxRequest; ///< Set on NACK pulse.
+
+static uint8_t s_pBuf[DATABUF_SIZE + 2];
+static uint16_t s_uwSize;
+static uint16_t s_uwCount; ///< Bytes on the wire - even unless exact size.
+static uint16_t s_uwIdx;
+
+static void amigaWaitBusy(uint8_t ubLevel) {
+	s_ubWaitBusy = ubLevel;
+	s_ullWaitStart = halGetCycles();
+}
+
+static uint16_t amigaGetWireSize(uint16_t uwSize) {
+	if(s_uwProtoFlags & PBPROTO_FLAG_EXACT_SIZE)
+		return uwSize;
+	return (uwSize + 1) & ~1;
+}
+
+static void amigaRelease(void) {
+	s_ubSel = 0;
+	s_ubPout = 0;
+	s_ubDataDrive = 0;
+}
+
+static void amigaStartCmd(uint8_t ubCmd, uint8_t ubNextPhase) {
+	s_ubData = ubCmd;
+	s_ubDataDrive = 1;
+	s_ubPout = 0;
+	s_ubSel = 1;
+	s_ubPhase = ubNextPhase;
+	amigaWaitBusy(1);
+}
+
+static void amigaStep(uint64_t ullNow) {
+	switch(s_ubPhase) {
+		case PH_IDLE:
+			if(s_ubBusy || !s_ubAvrReady)
+				break;
+			if(s_ubRxRequest) {
+				s_ubRxRequest = 0;
+				uint8_t ubCmd = PBPROTO_CMD_RECV;
+				if(s_ubBurst) {
+					ubCmd = (s_uwProtoFlags & PBPROTO_FLAG_RECV_BATCH) ?
+						PBPROTO_CMD_RECV_BATCH : PBPROTO_CMD_RECV_BURST;
+				}
+				s_ubCmd = ubCmd;
+				amigaStartCmd(ubCmd, PH_R_SIZE_HI);
+			}
+			else if(benchGetAmigaFrame(s_pBuf, &s_uwSize)) {
+				uint8_t ubCmd = PBPROTO_CMD_SEND;
+				if(s_ubBurst) {
+					ubCmd = (s_uwProtoFlags & PBPROTO_FLAG_SEND_BATCH) ?
+						PBPROTO_CMD_SEND_BATCH : PBPROTO_CMD_SEND_BURST;
+				}
+				s_ubCmd = ubCmd;
+				s_ubBatchFrames = 0;
+				amigaStartCmd(ubCmd, PH_W_SIZE_HI);
+			}
+			else
+				s_ullNextAt = ullNow + s_sTiming.uwReact;
+			break;
+		case PH_END:
+			s_ubPhase = PH_IDLE;
+			break;
+
+		// ----- Amiga sends -----
+		case PH_W_SIZE_HI:
+			s_ubData = s_uwSize >> 8;
+			s_ubPout = 1;
+			s_ubPhase = PH_W_SIZE_LO;
+			amigaWaitBusy(0);
+			break;
+		case PH_W_SIZE_LO:
+			s_ubData = s_uwSize & 0xFF;
+			s_ubPout = 0;
+			if(!s_uwSize && s_ubCmd == PBPROTO_CMD_SEND_BATCH) {
+				// End of batch
+				s_ubPhase = PH_W_BATCH_END;
+				amigaWaitBusy(1);
+				break;
+			}
+			s_uwCount = amigaGetWireSize(s_uwSize);
+			s_uwIdx = 0;
+			s_ubPhase = PH_W_DATA;
+			amigaWaitBusy(1);
+			break;
+		case PH_W_DATA:
+			s_ubData = s_uwIdx < s_uwSize ? s_pBuf[s_uwIdx] : 0;
+			s_ubPout ^= 1;
+			++s_uwIdx;
+			if(s_ubBurst) {
+				s_ullNextAt = ullNow + s_sTiming.uwBurstStep;
+				if(s_uwIdx == s_uwCount) {
+					if(s_ubPout) {
+						// Odd byte's POUT edge doubles as first end handshake
+						s_ubPhase = PH_W_END2;
+						amigaWaitBusy(!s_ubBusy);
+					}
+					else
+						s_ubPhase = PH_W_END1;
+				}
+			}
+			else {
+				if(s_uwIdx == s_uwCount)
+					s_ubPhase = PH_W_DONE;
+				amigaWaitBusy(!s_ubBusy);
+			}
+			break;
+		case PH_W_END1:
+			s_ubPout = 1;
+			s_ubPhase = PH_W_END2;
+			amigaWaitBusy(!s_ubBusy);
+			break;
+		case PH_W_END2:
+			s_ubPout = 0;
+			s_ubPhase = PH_W_DONE;
+			amigaWaitBusy(!s_ubBusy);
+			break;
+		case PH_W_DONE:
+			s_ubListening = 1;
+			++g_sAmigaStats.ulTxFrames;
+			g_sAmigaStats.ullTxBytes += s_uwSize;
+			if(s_ubCmd == PBPROTO_CMD_SEND_BATCH) {
+				// Next frame of batch or zero size to end it
+				if(
+					++s_ubBatchFrames >= PBPROTO_BATCH_MAX_FRAMES ||
+					!benchGetAmigaFrame(s_pBuf, &s_uwSize)
+				)
+					s_uwSize = 0;
+				s_ubPhase = PH_W_SIZE_HI;
+				break;
+			}
+			amigaRelease();
+			s_ubPhase = PH_END;
+			amigaWaitBusy(0);
+			break;
+		case PH_W_BATCH_END:
+			amigaRelease();
+			s_ubPhase = PH_END;
+			amigaWaitBusy(0);
+			break;
+
+		// ----- Amiga receives -----
+		case PH_R_SIZE_HI:
+			s_ubDataDrive = 0;
+			s_ubPout = 1;
+			s_ubPhase = PH_R_SIZE_LO;
+			amigaWaitBusy(0);
+			break;
+		case PH_R_SIZE_LO:
+			s_uwSize = s_ubAvrData << 8;
+			s_ubPout = 0;
+			s_ubPhase = PH_R_READY;
+			amigaWaitBusy(1);
+			break;
+		case PH_R_READY:
+			s_uwSize |= s_ubAvrData;
+			s_uwCount = amigaGetWireSize(s_uwSize);
+			s_uwIdx = 0;
+			if(s_ubCmd == PBPROTO_CMD_RECV_BATCH && !s_uwSize) {
+				// End of batch
+				amigaRelease();
+				s_ubPhase = PH_END;
+				amigaWaitBusy(0);
+			}
+			else if(s_uwCount > sizeof(s_pBuf)) {
+				amigaRelease();
+				++g_sAmigaStats.ulTimeouts;
+				s_ubPhase = PH_END;
+				amigaWaitBusy(0);
+			}
+			else if(s_ubBurst) {
+				s_ubPout = 1;
+				s_ubPhase = PH_R_BURST;
+				amigaWaitBusy(0);
+			}
+			else
+				s_ubPhase = PH_R_DATA;
+			break;
+		case PH_R_DATA:
+			if(s_uwIdx == s_uwCount) {
+				// Final POUT edge - ends high on even sizes
+				s_ubPout ^= 1;
+				s_ubPhase = PH_R_DONE;
+				s_ullNextAt = ullNow + s_sTiming.uwReact;
+			}
+			else {
+				s_ubPout ^= 1;
+				s_ubPhase = PH_R_DATA_GET;
+				amigaWaitBusy(!s_ubBusy);
+			}
+			break;
+		case PH_R_DATA_GET:
+			s_pBuf[s_uwIdx++] = s_ubAvrData;
+			s_ubPhase = PH_R_DATA;
+			break;
+		case PH_R_BURST:
+			// Read byte and ack it - AVR puts next one after seeing POUT toggle
+			if(s_uwIdx == s_uwCount) {
+				s_ubPhase = PH_R_END1;
+				break;
+			}
+			s_pBuf[s_uwIdx++] = s_ubAvrData;
+			s_ubPout ^= 1;
+			s_ullNextAt = ullNow + s_sTiming.uwBurstStep;
+			break;
+		case PH_R_END1:
+			s_ubPout = 0;
+			s_ubPhase = PH_R_END2;
+			amigaWaitBusy(1);
+			break;
+		case PH_R_END2:
+			s_ubPout = 1;
+			s_ubPhase = PH_R_DONE;
+			amigaWaitBusy(0);
+			break;
+		case PH_R_DONE:
+			// Empty frame means AVR had nothing after all, e.g. it dropped one
+			if(s_uwSize) {
+				++g_sAmigaStats.ulRxFrames;
+				g_sAmigaStats.ullRxBytes += s_uwSize;
+				benchOnAmigaFrame(s_pBuf, s_uwSize);
+			}
+			if(s_ubCmd == PBPROTO_CMD_RECV_BATCH) {
+				// Ask for next frame of batch
+				s_ubPout = 0;
+				s_ubPhase = PH_R_SIZE_HI;
+				amigaWaitBusy(1);
+			}
+			else {
+				amigaRelease();
+				s_ubPhase = PH_END;
+				amigaWaitBusy(0);
+			}
+			break;
+	}
+}
+
+void amigaTick(void) {
+	uint64_t ullNow = halGetCycles();
+	if(s_ubWaitBusy != WAIT_NONE) {
+		if(s_ubBusy != s_ubWaitBusy) {
+			if(ullNow - s_ullWaitStart > AMIGA_TIMEOUT) {
+				amigaRelease();
+				++g_sAmigaStats.ulTimeouts;
+				s_ubWaitBusy = WAIT_NONE;
+				s_ubPhase = PH_IDLE;
+			}
+			return;
+		}
+		s_ubWaitBusy = WAIT_NONE;
+		s_ullNextAt = ullNow + s_sTiming.uwReact;
+	}
+	if(ullNow >= s_ullNextAt)
+		amigaStep(ullNow);
+}
+
+uint8_t amigaGetStatusLines(void) {
+	return PAR_NSTROBE | (s_ubPout ? PAR_POUT : 0) | (s_ubSel ? PAR_SEL : 0);
+}
+
+uint8_t amigaGetDataLines(uint8_t *pData) {
+	if(!s_ubDataDrive)
+		return 0;
+	*pData = s_ubData;
+	return 1;
+}
+
+void amigaSetAvrLines(uint8_t ubStatus, uint8_t ubData, uint8_t ubDataDdr) {
+	uint8_t ubNack = (ubStatus & PAR_NACK) != 0;
+	if(s_ubNack && !ubNack && s_ubListening)
+		s_ubRxRequest = 1;
+	s_ubNack = ubNack;
+	if(ubNack)
+		s_ubAvrReady = 1;
+	s_ubBusy = (ubStatus & PAR_BUSY) != 0;
+	s_ubAvrData = (ubData & ubDataDdr) | ~ubDataDdr;
+}
+
+void amigaSetProtoFlags(uint16_t uwFlags) {
+	s_uwProtoFlags = uwFlags;
+}
+
+uint8_t amigaIsIdle(void) {
+	return s_ubPhase == PH_IDLE && !s_ubRxRequest;
+}
+
+void amigaInit(const tAmigaTiming *pTiming, uint8_t ubBurst) {
+	memset(&g_sAmigaStats, 0, sizeof(g_sAmigaStats));
+	s_sTiming = *pTiming;
+	s_ubBurst = ubBurst;
+	s_uwProtoFlags = 0;
+	amigaRelease();
+	s_ubBusy = 0;
+	s_ubNack = 1;
+	s_ubAvrData = 0xFF;
+	s_ubPhase = PH_IDLE;
+	s_ubCmd = 0;
+	s_ubWaitBusy = WAIT_NONE;
+	s_ullNextAt = 0;
+	s_ubAvrReady = 0;
+	s_ubListening = 0;
+	s_ubRxRequest = 0;
+}
@@ -0,0 +1,925 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#include <host/bench.h>
+#include <stddef.h>
+#include <string.h>
+#include <main/global.h>
+#include <main/config.h>
+#include <main/pb_proto.h>
+#include <main/pkt_buf.h>
+#include <main/stats.h>
+#include <main/net/eth.h>
+#include <main/net/net.h>
+#include <main/net/arp.h>
+#include <main/net/ip.h>
+#include <main/net/hdrc.h>
+#include <main/cmd.h>
+#include <main/spi/enc28j60.h>
+#include <host/hal.h>
+#include <host/amiga.h>
+#include <host/encsim.h>
+
+#define BENCH_HDR_SIZE (ETH_HDR_SIZE + 20 + 8)  // eth + ip + udp
+#define BENCH_MIN_SIZE (BENCH_HDR_SIZE + 4)     // + sequence number
+#define BENCH_WIRE_MIN 60
+#define BENCH_WIRE_OVERHEAD 24 // preamble, CRC, inter-frame gap
+#define BENCH_STACK_DEPTH 8
+#define BENCH_BAD_CSUM_PORT 9999 // UDP target port of frames with broken checksum
+#define BENCH_LINK_DOWN_MS 30 // how long link stays down after each flap
+#define BENCH_ECHO_ID 0x1234
+#define BENCH_ECHO_OWED_MAX 64 // pings Amiga's stack can keep before dropping
+#define BENCH_HDRC_CTX_IPV4 0 // header compression contexts installed by Amiga
+#define BENCH_HDRC_CTX_ARP 3
+
+// benchMakeFrame() flags
+#define BENCH_FRAME_PAD      1 // pad to Ethernet minimum
+#define BENCH_FRAME_NO_CSUM  2 // leave checksums to ENC28J60
+#define BENCH_FRAME_BAD_CSUM 4 // break UDP checksum
+
+tBenchStats g_sBenchStats;
+
+static tBenchConfig s_sConfig;
+static const uint8_t s_pRemoteMac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+static const uint8_t s_pRemoteIp[4] = {192, 168, 2, 1};
+static const uint8_t s_pAmigaIp[4] = {192, 168, 2, 222};
+static const uint8_t s_pNoiseIp[4] = {192, 168, 2, 50};
+static const uint8_t s_pNoiseMcastMac[6] = {0x01, 0x00, 0x5E, 0x01, 0x01, 0x01};
+static const uint8_t s_pAllHostsMac[6] = {0x01, 0x00, 0x5E, 0x00, 0x00, 0x01};
+static const uint8_t s_pNetmask[4] = {255, 255, 255, 0};
+static const uint8_t s_pGatewayIp[4] = {192, 168, 2, 254};
+
+static uint8_t s_ubOnlineSent;
+static uint8_t s_ubCmdNext;  ///< Next row of s_pCmds to consider
+static uint8_t s_ubNeighReplyNext; ///< Remote host owes reply to AVR's ARP request
+static uint8_t s_ubCmdPending;
+static uint8_t s_ubExtraNext; ///< Bit per s_pExtras row due to be injected
+static uint16_t s_uwArpOwed;  ///< ARP requests Amiga's stack is yet to answer
+static uint32_t s_ulArpSent;  ///< ARP replies sent by Amiga
+static uint16_t s_pEchoOwed[BENCH_ECHO_OWED_MAX]; ///< Sequences of pings to answer
+static uint8_t s_ubEchoOwedHead;
+static uint8_t s_ubEchoOwedCount;
+static uint32_t s_ulEchoSent; ///< Echo replies sent by Amiga
+static uint16_t s_uwProtoFlags; ///< Accepted by AVR
+static uint32_t s_ulTxQueued;
+static uint64_t s_ullNextInject;
+static uint64_t s_ullNextLinkChange;
+static uint8_t s_ubLinkDown;      ///< Link state on the wire
+static uint8_t s_ubAmigaLinkDown; ///< Link state as told to Amiga
+
+typedef struct _tStageCtx {
+	uint64_t ullStart;
+	uint64_t ullChildren;
+} tStageCtx;
+
+static tStageCtx s_pStack[BENCH_STACK_DEPTH];
+static uint8_t s_ubDepth;
+
+// ---------- Frames ----------
+
+/// One's complement sum of big endian words, without folding.
+static uint32_t benchSum(uint32_t ulSum, const uint8_t *pData, uint16_t uwLength) {
+	for(uint16_t i = 0; i < uwLength; i += 2)
+		ulSum += (pData[i] << 8) | (i + 1 < uwLength ? pData[i + 1] : 0);
+	return ulSum;
+}
+
+static uint16_t benchFold(uint32_t ulSum) {
+	while(ulSum >> 16)
+		ulSum = (ulSum & 0xFFFF) + (ulSum >> 16);
+	return ulSum;
+}
+
+static uint16_t benchIpChecksum(const uint8_t *pData, uint8_t ubLength) {
+	return ~benchFold(benchSum(0, pData, ubLength));
+}
+
+/// Sums UDP datagram of given IP header along with its pseudo header.
+static uint16_t benchUdpSum(const uint8_t *pIp) {
+	uint16_t uwUdpLength = net_get_word(pIp + 2) - 20;
+	uint32_t ulSum = benchSum(0, pIp + 12, 8) + pIp[9] + uwUdpLength;
+	return benchFold(benchSum(ulSum, pIp + 20, uwUdpLength));
+}
+
+/**
+ * Builds IPv4/UDP frame with sequence number and pattern payload.
+ * @param ubFlags Combination of BENCH_FRAME_* flags.
+ * @return Frame size, padded to Ethernet minimum if needed.
+ */
+static uint16_t benchMakeFrame(
+	uint8_t *pBuf, const uint8_t *pDstMac, const uint8_t *pSrcMac,
+	const uint8_t *pSrcIp, const uint8_t *pDstIp, uint32_t ulSeq, uint8_t ubFlags
+) {
+	uint16_t uwSize = s_sConfig.uwFrameSize;
+	uint16_t uwIpLength = uwSize - ETH_HDR_SIZE;
+	uint8_t *pIp = pBuf + ETH_HDR_SIZE;
+	uint8_t *pUdp = pIp + 20;
+
+	net_copy_mac(pDstMac, pBuf + ETH_OFF_TGT_MAC);
+	net_copy_mac(pSrcMac, pBuf + ETH_OFF_SRC_MAC);
+	net_put_word(pBuf + ETH_OFF_TYPE, ETH_TYPE_IPV4);
+
+	memset(pIp, 0, 20);
+	pIp[0] = 0x45;
+	net_put_word(pIp + 2, uwIpLength);
+	net_put_word(pIp + 4, (uint16_t)ulSeq);
+	pIp[8] = 64;
+	pIp[9] = 17;
+	net_copy_ip(pSrcIp, pIp + 12);
+	net_copy_ip(pDstIp, pIp + 16);
+
+	net_put_word(pUdp + 0, 1234);
+	net_put_word(pUdp + 2, (ubFlags & BENCH_FRAME_BAD_CSUM) ? BENCH_BAD_CSUM_PORT : 5678);
+	net_put_word(pUdp + 4, uwIpLength - 20);
+	net_put_word(pUdp + 6, 0);
+
+	net_put_long(pBuf + BENCH_HDR_SIZE, ulSeq);
+	for(uint16_t i = BENCH_MIN_SIZE; i < uwSize; ++i)
+		pBuf[i] = (uint8_t)(ulSeq + i);
+
+	if(!(ubFlags & BENCH_FRAME_NO_CSUM)) {
+		net_put_word(pIp + 10, benchIpChecksum(pIp, 20));
+		uint16_t uwCsum = ~benchUdpSum(pIp);
+		if(ubFlags & BENCH_FRAME_BAD_CSUM)
+			uwCsum ^= 0x0101;
+		net_put_word(pUdp + 6, uwCsum ? uwCsum : 0xFFFF);
+	}
+
+	if((ubFlags & BENCH_FRAME_PAD) && uwSize < BENCH_WIRE_MIN) {
+		memset(pBuf + uwSize, 0, BENCH_WIRE_MIN - uwSize);
+		uwSize = BENCH_WIRE_MIN;
+	}
+	return uwSize;
+}
+
+/**
+ * Checks frame built by benchMakeFrame().
+ * Trailing padding is allowed, truncation is not.
+ */
+static uint8_t benchCheckFrame(
+	const uint8_t *pData, uint16_t uwSize, const uint8_t *pDstMac
+) {
+	if(uwSize < s_sConfig.uwFrameSize)
+		return 0;
+	if(!net_compare_mac(pData + ETH_OFF_TGT_MAC, pDstMac))
+		return 0;
+	if(eth_get_pkt_type(pData) != ETH_TYPE_IPV4)
+		return 0;
+	const uint8_t *pIp = pData + ETH_HDR_SIZE;
+	if(net_get_word(pIp + 2) != s_sConfig.uwFrameSize - ETH_HDR_SIZE)
+		return 0;
+	if(benchIpChecksum(pIp, 20) != 0)
+		return 0;
+	// Zero UDP checksum means there's none
+	if(net_get_word(pIp + 20 + 6) && benchUdpSum(pIp) != 0xFFFF)
+		return 0;
+	uint32_t ulSeq = net_get_long(pData + BENCH_HDR_SIZE);
+	for(uint16_t i = BENCH_MIN_SIZE; i < s_sConfig.uwFrameSize; ++i)
+		if(pData[i] != (uint8_t)(ulSeq + i))
+			return 0;
+	return 1;
+}
+
+/**
+ * Builds ARP frame for Amiga's IP - request from remote host or Amiga's reply.
+ * @return Frame size, requests are padded to Ethernet minimum.
+ */
+static uint16_t benchMakeArp(uint8_t *pBuf, uint8_t ubReply) {
+	uint8_t *pArp = pBuf + ETH_HDR_SIZE;
+	memset(pBuf, 0, BENCH_WIRE_MIN);
+	net_put_word(pArp + ARP_OFF_HW_TYPE, 1);
+	net_put_word(pArp + ARP_OFF_PROT_TYPE, ETH_TYPE_IPV4);
+	pArp[ARP_OFF_HW_SIZE] = 6;
+	pArp[ARP_OFF_PROT_SIZE] = 4;
+	if(ubReply) {
+		net_copy_mac(s_pRemoteMac, pBuf + ETH_OFF_TGT_MAC);
+		net_copy_mac(g_sConfig.mac_addr, pBuf + ETH_OFF_SRC_MAC);
+		net_put_word(pArp + ARP_OFF_OP, ARP_REPLY);
+		net_copy_mac(g_sConfig.mac_addr, pArp + ARP_OFF_SRC_MAC);
+		net_copy_ip(s_pAmigaIp, pArp + ARP_OFF_SRC_IP);
+		net_copy_mac(s_pRemoteMac, pArp + ARP_OFF_TGT_MAC);
+		net_copy_ip(s_pRemoteIp, pArp + ARP_OFF_TGT_IP);
+	}
+	else {
+		net_copy_bcast_mac(pBuf + ETH_OFF_TGT_MAC);
+		net_copy_mac(s_pRemoteMac, pBuf + ETH_OFF_SRC_MAC);
+		net_put_word(pArp + ARP_OFF_OP, ARP_REQUEST);
+		net_copy_mac(s_pRemoteMac, pArp + ARP_OFF_SRC_MAC);
+		net_copy_ip(s_pRemoteIp, pArp + ARP_OFF_SRC_IP);
+		net_copy_ip(s_pAmigaIp, pArp + ARP_OFF_TGT_IP);
+	}
+	net_put_word(pBuf + ETH_OFF_TYPE, ETH_TYPE_ARP);
+	return ubReply ? ETH_HDR_SIZE + ARP_SIZE : BENCH_WIRE_MIN;
+}
+
+/**
+ * Builds ICMP echo frame for Amiga's IP - request from remote host or reply,
+ * as made by Amiga or AVR. Payload has pattern based on sequence number.
+ * Reply keeps everything from request but addresses and ICMP type, so its IP
+ * header checksum stays the same.
+ * @return Frame size, requests are padded to Ethernet minimum.
+ */
+static uint16_t benchMakeEcho(uint8_t *pBuf, uint16_t uwSeq, uint8_t ubReply) {
+	uint16_t uwSize = s_sConfig.uwFrameSize;
+	uint16_t uwIpLength = uwSize - ETH_HDR_SIZE;
+	uint8_t *pIp = pBuf + ETH_HDR_SIZE;
+	uint8_t *pIcmp = pIp + IP_MIN_HDR_SIZE;
+	memset(pBuf, 0, BENCH_WIRE_MIN);
+
+	net_copy_mac(ubReply ? s_pRemoteMac : g_sConfig.mac_addr, pBuf + ETH_OFF_TGT_MAC);
+	net_copy_mac(ubReply ? g_sConfig.mac_addr : s_pRemoteMac, pBuf + ETH_OFF_SRC_MAC);
+	net_put_word(pBuf + ETH_OFF_TYPE, ETH_TYPE_IPV4);
+
+	pIp[0] = 0x45;
+	net_put_word(pIp + 2, uwIpLength);
+	net_put_word(pIp + 4, uwSeq);
+	pIp[8] = 64;
+	pIp[9] = IP_PROTOCOL_ICMP;
+	net_copy_ip(ubReply ? s_pAmigaIp : s_pRemoteIp, pIp + IP_SRC_IP_OFF);
+	net_copy_ip(ubReply ? s_pRemoteIp : s_pAmigaIp, pIp + IP_TGT_IP_OFF);
+	net_put_word(pIp + IP_CHECKSUM_OFF, benchIpChecksum(pIp, IP_MIN_HDR_SIZE));
+
+	pIcmp[0] = ubReply ? ICMP_TYPE_ECHO_REPLY : ICMP_TYPE_ECHO_REQUEST;
+	net_put_word(pIcmp + 4, BENCH_ECHO_ID);
+	net_put_word(pIcmp + 6, uwSeq);
+	uint16_t uwIcmpLength = uwIpLength - IP_MIN_HDR_SIZE;
+	for(uint16_t i = ICMP_HDR_SIZE; i < uwIcmpLength; ++i)
+		pIcmp[i] = (uint8_t)(uwSeq + i);
+	net_put_word(
+		pIcmp + ICMP_CHECKSUM_OFF, ~benchFold(benchSum(0, pIcmp, uwIcmpLength))
+	);
+	return (ubReply || uwSize >= BENCH_WIRE_MIN) ? uwSize : BENCH_WIRE_MIN;
+}
+
+static uint8_t benchIsEcho(const uint8_t *pData, uint16_t uwSize, uint8_t ubType) {
+	return uwSize >= ETH_HDR_SIZE + IP_MIN_HDR_SIZE + ICMP_HDR_SIZE &&
+		eth_is_ipv4_pkt(pData) &&
+		ip_get_protocol(pData + ETH_HDR_SIZE) == IP_PROTOCOL_ICMP &&
+		pData[ETH_HDR_SIZE + IP_MIN_HDR_SIZE] == ubType;
+}
+
+/**
+ * Sets hash table bit for given destination, as Amiga's stack would do when
+ * joining multicast group. Bit is picked by bits 28:23 of MAC's CRC-32.
+ */
+static void benchHashAdd(uint8_t *pHash, const uint8_t *pMac) {
+	uint32_t ulCrc = 0xFFFFFFFF;
+	for(uint8_t i = 0; i < 6; ++i) {
+		uint8_t ubByte = pMac[i];
+		for(uint8_t j = 0; j < 8; ++j) {
+			uint8_t ubNext = (ulCrc >> 31) ^ (ubByte & 1);
+			ulCrc <<= 1;
+			if(ubNext)
+				ulCrc ^= 0x04C11DB7;
+			ubByte >>= 1;
+		}
+	}
+	uint8_t ubBit = (ulCrc >> 23) & 0x3F;
+	pHash[ubBit >> 3] |= 1 << (ubBit & 7);
+}
+
+/**
+ * Builds CMD_SETFILTER frame: own unicast, all-hosts group through hash table
+ * and ARP broadcasts through pattern match. Other broadcasts are rejected.
+ */
+static uint16_t benchMakeFilterCmd(uint8_t *pBuf) {
+	memset(pBuf, 0, ETH_HDR_SIZE + sizeof(enc28j60_filter_t));
+	pBuf[0] = CMD_SETFILTER;
+	pBuf[1] = 1;
+	net_copy_mac(g_sConfig.mac_addr, pBuf + ETH_OFF_SRC_MAC);
+	net_put_word(pBuf + ETH_OFF_TYPE, ETH_TYPE_MAGIC_CMD);
+
+	enc28j60_filter_t *pFilter = (enc28j60_filter_t*)&pBuf[ETH_HDR_SIZE];
+	pFilter->flags = ENC28J60_FILTER_UCAST | ENC28J60_FILTER_HASH |
+		ENC28J60_FILTER_PATTERN;
+	benchHashAdd(pFilter->hash, s_pAllHostsMac);
+
+	// Broadcast destination and ARP EtherType
+	static const uint8_t pArp[8] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x08, 0x06};
+	pFilter->pattern_mask[0] = 0x3F;
+	pFilter->pattern_mask[1] = 0x30;
+	net_put_word(pFilter->pattern_csum, benchIpChecksum(pArp, sizeof(pArp)));
+	return ETH_HDR_SIZE + sizeof(enc28j60_filter_t);
+}
+
+/**
+ * Builds CMD_SETROUTE frame, which Amiga sends in IP-only mode.
+ */
+static uint16_t benchMakeRouteCmd(uint8_t *pBuf) {
+	memset(pBuf, 0, ETH_HDR_SIZE + 8);
+	pBuf[0] = CMD_SETROUTE;
+	net_copy_mac(g_sConfig.mac_addr, pBuf + ETH_OFF_SRC_MAC);
+	net_put_word(pBuf + ETH_OFF_TYPE, ETH_TYPE_MAGIC_CMD);
+	net_copy_ip(s_pNetmask, pBuf + ETH_HDR_SIZE);
+	net_copy_ip(s_pGatewayIp, pBuf + ETH_HDR_SIZE + 4);
+	return ETH_HDR_SIZE + 8;
+}
+
+/**
+ * Builds CMD_SETHDRCTX frame. Amiga installs contexts for IPv4 and ARP
+ * traffic with remote host, so that both directions get compressed.
+ */
+static uint16_t benchMakeHdrCtxCmd(uint8_t *pBuf, uint8_t ubArp) {
+	memset(pBuf, 0, ETH_HDR_SIZE + 9);
+	pBuf[0] = CMD_SETHDRCTX;
+	net_copy_mac(g_sConfig.mac_addr, pBuf + ETH_OFF_SRC_MAC);
+	net_put_word(pBuf + ETH_OFF_TYPE, ETH_TYPE_MAGIC_CMD);
+	pBuf[ETH_HDR_SIZE] = ubArp ? BENCH_HDRC_CTX_ARP : BENCH_HDRC_CTX_IPV4;
+	net_copy_mac(s_pRemoteMac, pBuf + ETH_HDR_SIZE + 1);
+	net_put_word(pBuf + ETH_HDR_SIZE + 7, ubArp ? ETH_TYPE_ARP : ETH_TYPE_IPV4);
+	return ETH_HDR_SIZE + 9;
+}
+
+/**
+ * Builds remote host's reply to ARP request made by AVR on Amiga's behalf.
+ */
+static uint16_t benchMakeNeighReply(uint8_t *pBuf) {
+	uint8_t *pArp = pBuf + ETH_HDR_SIZE;
+	memset(pBuf, 0, BENCH_WIRE_MIN);
+	net_copy_mac(g_sConfig.mac_addr, pBuf + ETH_OFF_TGT_MAC);
+	net_copy_mac(s_pRemoteMac, pBuf + ETH_OFF_SRC_MAC);
+	net_put_word(pBuf + ETH_OFF_TYPE, ETH_TYPE_ARP);
+	arp_make_request(pArp, s_pRemoteMac, s_pRemoteIp, s_pAmigaIp);
+	arp_make_reply(pArp, s_pRemoteMac, s_pRemoteIp);
+	net_copy_mac(g_sConfig.mac_addr, pArp + ARP_OFF_TGT_MAC);
+	return BENCH_WIRE_MIN;
+}
+
+// ---------- Scenario tables ----------
+
+/**
+ * Command Amiga sends after going online, before any other frame.
+ * Each command waits for response of previous one.
+ */
+typedef struct _tBenchCmd {
+	uint8_t (*cbIsWanted)(void);
+	uint16_t (*cbMake)(uint8_t *pBuf);
+} tBenchCmd;
+
+static uint8_t benchWantsFilter(void) {
+	return s_sConfig.ubFilter;
+}
+
+static uint8_t benchWantsRoute(void) {
+	return (s_uwProtoFlags & PBPROTO_FLAG_IP_ONLY) != 0;
+}
+
+static uint8_t benchWantsHdrCtx(void) {
+	return (s_uwProtoFlags & PBPROTO_FLAG_HDR_COMPRESS) != 0;
+}
+
+static uint16_t benchMakeHdrCtxIpv4Cmd(uint8_t *pBuf) {
+	return benchMakeHdrCtxCmd(pBuf, 0);
+}
+
+static uint16_t benchMakeHdrCtxArpCmd(uint8_t *pBuf) {
+	return benchMakeHdrCtxCmd(pBuf, 1);
+}
+
+static const tBenchCmd s_pCmds[] = {
+	{benchWantsFilter, benchMakeFilterCmd},
+	{benchWantsRoute, benchMakeRouteCmd},
+	{benchWantsHdrCtx, benchMakeHdrCtxIpv4Cmd},
+	{benchWantsHdrCtx, benchMakeHdrCtxArpCmd},
+};
+
+#define BENCH_CMD_COUNT (sizeof(s_pCmds) / sizeof(s_pCmds[0]))
+
+/**
+ * Extra frame put on the wire after every n regular rx ones.
+ * Rows are injected in table order when several are due at once.
+ */
+typedef struct _tBenchExtra {
+	size_t ulEveryOffs;    ///< uint16_t period in tBenchConfig
+	size_t ulInjectedOffs; ///< uint32_t counter in tBenchStats
+	uint16_t (*cbMake)(uint8_t *pBuf, uint32_t ulIdx);
+} tBenchExtra;
+
+/// Alternates broadcasts and multicasts to group nobody has joined.
+static uint16_t benchMakeNoise(uint8_t *pBuf, uint32_t ulIdx) {
+	uint8_t pBcastMac[6];
+	net_copy_bcast_mac(pBcastMac);
+	return benchMakeFrame(
+		pBuf, (ulIdx & 1) ? pBcastMac : s_pNoiseMcastMac, s_pRemoteMac,
+		s_pRemoteIp, s_pNoiseIp, ulIdx, BENCH_FRAME_PAD
+	);
+}
+
+static uint16_t benchMakeBadCsum(uint8_t *pBuf, uint32_t ulIdx) {
+	return benchMakeFrame(
+		pBuf, g_sConfig.mac_addr, s_pRemoteMac, s_pRemoteIp, s_pAmigaIp,
+		ulIdx, BENCH_FRAME_PAD | BENCH_FRAME_BAD_CSUM
+	);
+}
+
+static uint16_t benchMakeArpRequest(uint8_t *pBuf, uint32_t ulIdx) {
+	return benchMakeArp(pBuf, 0);
+}
+
+static uint16_t benchMakeEchoRequest(uint8_t *pBuf, uint32_t ulIdx) {
+	return benchMakeEcho(pBuf, ulIdx, 0);
+}
+
+#define BENCH_EXTRA(every, injected, cbMake) { \
+	offsetof(tBenchConfig, every), offsetof(tBenchStats, injected), cbMake \
+}
+
+static const tBenchExtra s_pExtras[] = {
+	BENCH_EXTRA(uwNoiseEvery, ulNoiseInjected, benchMakeNoise),
+	BENCH_EXTRA(uwBadCsumEvery, ulBadCsumInjected, benchMakeBadCsum),
+	BENCH_EXTRA(uwArpEvery, ulArpInjected, benchMakeArpRequest),
+	BENCH_EXTRA(uwEchoEvery, ulEchoInjected, benchMakeEchoRequest),
+};
+
+#define BENCH_EXTRA_COUNT (sizeof(s_pExtras) / sizeof(s_pExtras[0]))
+
+/**
+ * Packs header of Amiga's frame as accepted flags say: takes it away in
+ * IP-only mode or replaces it with context tag with header compression.
+ * @return New frame size.
+ */
+static uint16_t benchPackHdr(uint8_t *pBuf, uint16_t uwSize) {
+	if(s_uwProtoFlags & PBPROTO_FLAG_IP_ONLY) {
+		memmove(pBuf, pBuf + ETH_HDR_SIZE, uwSize - ETH_HDR_SIZE);
+		return uwSize - ETH_HDR_SIZE;
+	}
+	if(!(s_uwProtoFlags & PBPROTO_FLAG_HDR_COMPRESS))
+		return uwSize;
+	uint16_t uwType = eth_get_pkt_type(pBuf);
+	if(
+		net_compare_mac(pBuf + ETH_OFF_TGT_MAC, s_pRemoteMac) &&
+		(uwType == ETH_TYPE_IPV4 || uwType == ETH_TYPE_ARP)
+	) {
+		pBuf[0] = HDRC_TAG_CTX + (
+			uwType == ETH_TYPE_ARP ? BENCH_HDRC_CTX_ARP : BENCH_HDRC_CTX_IPV4
+		);
+		memmove(pBuf + 1, pBuf + ETH_HDR_SIZE, uwSize - ETH_HDR_SIZE);
+		return uwSize - ETH_HDR_SIZE + 1;
+	}
+	if(hdrc_is_tag(pBuf[0])) {
+		memmove(pBuf + 1, pBuf, uwSize);
+		pBuf[0] = HDRC_TAG_RAW;
+		return uwSize + 1;
+	}
+	return uwSize;
+}
+
+// ---------- Peer callbacks ----------
+
+uint8_t benchGetAmigaFrame(uint8_t *pBuf, uint16_t *pSize) {
+	if(!s_ubOnlineSent) {
+		// Same thing Amiga driver does when it gets opened
+		s_ubOnlineSent = 1;
+		net_copy_bcast_mac(pBuf + ETH_OFF_TGT_MAC);
+		net_copy_mac(g_sConfig.mac_addr, pBuf + ETH_OFF_SRC_MAC);
+		net_put_word(pBuf + ETH_OFF_TYPE, ETH_TYPE_MAGIC_ONLINE);
+		*pSize = ETH_HDR_SIZE;
+		if(s_sConfig.uwProtoFlags) {
+			net_put_word(pBuf + ETH_OFF_MAGIC_FLAGS, s_sConfig.uwProtoFlags);
+			*pSize += 2;
+			// Frames depend on accepted flags
+			s_ubCmdPending = 1;
+		}
+		return 1;
+	}
+	// Response is kept in AVR's data buffer, so wait for it like Amiga tools do
+	if(s_ubCmdPending)
+		return 0;
+	while(s_ubCmdNext < BENCH_CMD_COUNT) {
+		const tBenchCmd *pCmd = &s_pCmds[s_ubCmdNext++];
+		if(pCmd->cbIsWanted()) {
+			s_ubCmdPending = 1;
+			*pSize = pCmd->cbMake(pBuf);
+			return 1;
+		}
+	}
+	// Stack holds its frames until it's told that link is back
+	if(s_ubAmigaLinkDown)
+		return 0;
+	if(s_uwArpOwed) {
+		--s_uwArpOwed;
+		++s_ulArpSent;
+		*pSize = benchPackHdr(pBuf, benchMakeArp(pBuf, 1));
+		return 1;
+	}
+	if(s_ubEchoOwedCount) {
+		--s_ubEchoOwedCount;
+		++s_ulEchoSent;
+		*pSize = benchPackHdr(pBuf, benchMakeEcho(pBuf, s_pEchoOwed[s_ubEchoOwedHead], 1));
+		s_ubEchoOwedHead = (s_ubEchoOwedHead + 1) % BENCH_ECHO_OWED_MAX;
+		return 1;
+	}
+	if(!(s_sConfig.ubScenario & BENCH_TX) || s_ulTxQueued >= s_sConfig.ulFrames)
+		return 0;
+	*pSize = benchMakeFrame(
+		pBuf, s_pRemoteMac, g_sConfig.mac_addr, s_pAmigaIp, s_pRemoteIp,
+		s_ulTxQueued,
+		(s_uwProtoFlags & PBPROTO_FLAG_CSUM_OFFLOAD) ? BENCH_FRAME_NO_CSUM : 0
+	);
+	*pSize = benchPackHdr(pBuf, *pSize);
+	++s_ulTxQueued;
+	return 1;
+}
+
+void benchOnAmigaFrame(const uint8_t *pData, uint16_t uwSize) {
+	uint8_t pFrame[ETH_HDR_SIZE + DATABUF_SIZE];
+	if((s_uwProtoFlags & PBPROTO_FLAG_HDR_COMPRESS) && uwSize && hdrc_is_tag(pData[0])) {
+		if(pData[0] == HDRC_TAG_RAW) {
+			++pData;
+			--uwSize;
+		}
+		else if(pData[0] == HDRC_TAG_CTX + BENCH_HDRC_CTX_IPV4) {
+			// Header is rebuilt from context, just like Amiga driver would do
+			net_copy_mac(g_sConfig.mac_addr, pFrame + ETH_OFF_TGT_MAC);
+			net_copy_mac(s_pRemoteMac, pFrame + ETH_OFF_SRC_MAC);
+			net_put_word(pFrame + ETH_OFF_TYPE, ETH_TYPE_IPV4);
+			memcpy(pFrame + ETH_HDR_SIZE, pData + 1, uwSize - 1);
+			pData = pFrame;
+			uwSize += ETH_HDR_SIZE - 1;
+			++g_sBenchStats.ulHdrcRx;
+		}
+		else {
+			// Remote host sends no ARP to Amiga's MAC, so no other tag may come
+			++g_sBenchStats.ulRxBad;
+			return;
+		}
+	}
+	if((s_uwProtoFlags & PBPROTO_FLAG_IP_ONLY) && uwSize && ip_get_version(pData) == 4) {
+		// Unwanted frames are told by target IP since their MAC is gone
+		if(uwSize >= IP_MIN_HDR_SIZE && net_compare_ip(ip_get_tgt_ip(pData), s_pNoiseIp)) {
+			++g_sBenchStats.ulNoiseRx;
+			return;
+		}
+		// Put back header which AVR took away, so frame is checked as usual
+		net_copy_mac(g_sConfig.mac_addr, pFrame + ETH_OFF_TGT_MAC);
+		net_copy_mac(s_pRemoteMac, pFrame + ETH_OFF_SRC_MAC);
+		net_put_word(pFrame + ETH_OFF_TYPE, ETH_TYPE_IPV4);
+		memcpy(pFrame + ETH_HDR_SIZE, pData, uwSize);
+		pData = pFrame;
+		uwSize += ETH_HDR_SIZE;
+	}
+	uint16_t uwType = eth_get_pkt_type(pData);
+	if(uwType >= ETH_TYPE_MAGIC_LINK) {
+		++g_sAmigaStats.ulRxMagic;
+		if(uwType == ETH_TYPE_MAGIC_ONLINE && uwSize >= ETH_OFF_MAGIC_FLAGS + 2) {
+			s_uwProtoFlags = net_get_word(pData + ETH_OFF_MAGIC_FLAGS);
+			amigaSetProtoFlags(s_uwProtoFlags);
+			s_ubCmdPending = 0;
+		}
+		else if(uwType == ETH_TYPE_MAGIC_CMD)
+			s_ubCmdPending = 0;
+		else if(uwType == ETH_TYPE_MAGIC_LINK && uwSize >= ETH_OFF_MAGIC_LINK + 2) {
+			s_ubAmigaLinkDown = !net_get_word(pData + ETH_OFF_MAGIC_LINK);
+			++g_sBenchStats.ulLinkEvents;
+		}
+		return;
+	}
+	if(uwType == ETH_TYPE_ARP) {
+		// Stack replies as soon as it can send
+		++g_sBenchStats.ulArpRx;
+		++s_uwArpOwed;
+		return;
+	}
+	if(benchIsEcho(pData, uwSize, ICMP_TYPE_ECHO_REQUEST)) {
+		++g_sBenchStats.ulEchoRx;
+		// Stack drops pings it has no room for
+		if(s_ubEchoOwedCount < BENCH_ECHO_OWED_MAX) {
+			s_pEchoOwed[(s_ubEchoOwedHead + s_ubEchoOwedCount) % BENCH_ECHO_OWED_MAX] =
+				net_get_word(pData + ETH_HDR_SIZE + IP_MIN_HDR_SIZE + 6);
+			++s_ubEchoOwedCount;
+		}
+		return;
+	}
+	if(pData[0] & 1) {
+		++g_sBenchStats.ulNoiseRx;
+		return;
+	}
+	if(
+		uwSize >= BENCH_HDR_SIZE &&
+		net_get_word(pData + ETH_HDR_SIZE + 20 + 2) == BENCH_BAD_CSUM_PORT
+	) {
+		++g_sBenchStats.ulBadCsumRx;
+		return;
+	}
+	if(benchCheckFrame(pData, uwSize, g_sConfig.mac_addr)) {
+		++g_sBenchStats.ulRxOk;
+		g_sBenchStats.ullPayloadBytes += s_sConfig.uwFrameSize;
+	}
+	else
+		++g_sBenchStats.ulRxBad;
+}
+
+void benchOnWireFrame(const uint8_t *pData, uint16_t uwSize) {
+	if(
+		eth_is_arp_pkt(pData) && uwSize >= ETH_HDR_SIZE + ARP_SIZE &&
+		arp_get_op(pData + ETH_HDR_SIZE) == ARP_REQUEST
+	) {
+		// AVR asks for remote host's MAC in IP-only mode
+		if(net_compare_ip(arp_get_tgt_ip(pData + ETH_HDR_SIZE), s_pRemoteIp)) {
+			++g_sBenchStats.ulNeighRequests;
+			s_ubNeighReplyNext = 1;
+		}
+		else
+			++g_sBenchStats.ulTxBad;
+		return;
+	}
+	if(eth_is_arp_pkt(pData)) {
+		// Same reply is expected from Amiga and from AVR
+		uint8_t pReply[BENCH_WIRE_MIN];
+		uint16_t uwReplySize = benchMakeArp(pReply, 1);
+		if(uwSize >= uwReplySize && !memcmp(pData, pReply, uwReplySize))
+			++g_sBenchStats.ulArpReplies;
+		else
+			++g_sBenchStats.ulTxBad;
+		return;
+	}
+	if(benchIsEcho(pData, uwSize, ICMP_TYPE_ECHO_REPLY)) {
+		// Same reply is expected from Amiga and from AVR
+		uint8_t pReply[DATABUF_SIZE];
+		uint16_t uwSeq = net_get_word(pData + ETH_HDR_SIZE + IP_MIN_HDR_SIZE + 6);
+		uint16_t uwReplySize = benchMakeEcho(pReply, uwSeq, 1);
+		if(uwSize >= uwReplySize && !memcmp(pData, pReply, uwReplySize))
+			++g_sBenchStats.ulEchoReplies;
+		else
+			++g_sBenchStats.ulTxBad;
+		return;
+	}
+	// With offload, UDP checksum must have been filled by ENC28J60
+	uint8_t ubCsumMissing = (s_uwProtoFlags & PBPROTO_FLAG_CSUM_OFFLOAD) &&
+		uwSize >= BENCH_HDR_SIZE && !net_get_word(pData + ETH_HDR_SIZE + 20 + 6);
+	if(!ubCsumMissing && benchCheckFrame(pData, uwSize, s_pRemoteMac)) {
+		++g_sBenchStats.ulTxOk;
+		g_sBenchStats.ullPayloadBytes += s_sConfig.uwFrameSize;
+	}
+	else
+		++g_sBenchStats.ulTxBad;
+}
+
+// ---------- Scenario ----------
+
+static uint8_t benchIsDone(void) {
+	tBenchStats *pStats = &g_sBenchStats;
+	if(s_sConfig.ubScenario & BENCH_RX) {
+		if(pStats->ulRxInjected < s_sConfig.ulFrames)
+			return 0;
+		// AVR counts overflows which encsim has counted already
+		uint32_t ulLost = g_sEncsimStats.ulRxOverflows +
+			g_sEncsimStats.ulRxFiltered + g_sEncsimStats.ulRxMissed +
+			stats[STATS_ID_PIO_RX].drop - stats_rx_buf.overflows +
+			stats[STATS_ID_PB_RX].drop;
+		if(
+			pStats->ulRxOk + pStats->ulRxBad + pStats->ulNoiseRx +
+			pStats->ulBadCsumRx + pStats->ulArpRx + stats_offload.arp_replies +
+			pStats->ulEchoRx + stats_offload.echo_replies + ulLost <
+			pStats->ulRxInjected + pStats->ulNoiseInjected +
+			pStats->ulBadCsumInjected + pStats->ulArpInjected +
+			pStats->ulEchoInjected
+		)
+			return 0;
+	}
+	if(
+		(s_sConfig.ubScenario & BENCH_TX) ||
+		pStats->ulArpInjected || pStats->ulEchoInjected
+	) {
+		// Flushed by AVR on link loss, or not queued at all without link
+		uint32_t ulLost = g_sEncsimStats.ulTxAborted + g_sEncsimStats.ulTxNoLink +
+			stats[STATS_ID_PIO_TX].drop + stats[STATS_ID_PB_TX].drop;
+		uint32_t ulQueued = s_ulArpSent + stats_offload.arp_replies +
+			s_ulEchoSent + stats_offload.echo_replies;
+		if(s_sConfig.ubScenario & BENCH_TX)
+			ulQueued += s_sConfig.ulFrames;
+		// Last frames are done on the wire before AVR sees it - wait for TX
+		// ring to drain, so that frames stuck in it end the run as timeout
+		if(
+			s_uwArpOwed || s_ubEchoOwedCount || stats_tx_queue.depth ||
+			pStats->ulTxOk + pStats->ulTxBad + pStats->ulArpReplies +
+			pStats->ulEchoReplies + ulLost < ulQueued
+		)
+			return 0;
+	}
+	return amigaIsIdle();
+}
+
+void benchTick(void) {
+	uint64_t ullNow = halGetCycles();
+	tBenchStats *pStats = &g_sBenchStats;
+
+	if(ullNow >= (uint64_t)s_sConfig.ulTimeLimitMs * (F_CPU / 1000)) {
+		pStats->ullEndCycles = ullNow;
+		pStats->ubTimedOut = 1;
+		halExit();
+	}
+
+	if(!pStats->ullStartCycles) {
+		if(!g_sAmigaStats.ulTxFrames)
+			return;
+		pStats->ullStartCycles = ullNow;
+		s_ullNextInject = ullNow;
+		s_ullNextLinkChange = ullNow +
+			(uint64_t)s_sConfig.uwLinkFlapMs * (F_CPU / 1000);
+	}
+
+	if(s_sConfig.uwLinkFlapMs && ullNow >= s_ullNextLinkChange) {
+		// Cable pull or switch reboot
+		s_ubLinkDown = !s_ubLinkDown;
+		encsimSetLink(!s_ubLinkDown);
+		if(s_ubLinkDown)
+			++pStats->ulLinkFlaps;
+		s_ullNextLinkChange = ullNow + (uint64_t)(s_ubLinkDown ?
+			BENCH_LINK_DOWN_MS : s_sConfig.uwLinkFlapMs) * (F_CPU / 1000);
+	}
+
+	if(s_ubNeighReplyNext && !s_ubLinkDown) {
+		uint8_t pFrame[BENCH_WIRE_MIN];
+		encsimInjectFrame(pFrame, benchMakeNeighReply(pFrame));
+		s_ubNeighReplyNext = 0;
+	}
+
+	if(
+		(s_sConfig.ubScenario & BENCH_RX) && !s_ubLinkDown &&
+		pStats->ulRxInjected < s_sConfig.ulFrames && ullNow >= s_ullNextInject
+	) {
+		uint8_t pFrame[DATABUF_SIZE];
+		uint16_t uwSize;
+		uint8_t ubExtra = 0;
+		while(ubExtra < BENCH_EXTRA_COUNT && !(s_ubExtraNext & (1 << ubExtra)))
+			++ubExtra;
+		if(ubExtra < BENCH_EXTRA_COUNT) {
+			const tBenchExtra *pExtra = &s_pExtras[ubExtra];
+			uint32_t *pInjected = (uint32_t*)((uint8_t*)pStats + pExtra->ulInjectedOffs);
+			uwSize = pExtra->cbMake(pFrame, *pInjected);
+			++*pInjected;
+			s_ubExtraNext &= ~(1 << ubExtra);
+		}
+		else {
+			uwSize = benchMakeFrame(
+				pFrame, g_sConfig.mac_addr, s_pRemoteMac, s_pRemoteIp, s_pAmigaIp,
+				pStats->ulRxInjected, BENCH_FRAME_PAD
+			);
+			++pStats->ulRxInjected;
+			for(ubExtra = 0; ubExtra < BENCH_EXTRA_COUNT; ++ubExtra) {
+				uint16_t uwEvery = *(const uint16_t*)(
+					(const uint8_t*)&s_sConfig + s_pExtras[ubExtra].ulEveryOffs
+				);
+				if(uwEvery && !(pStats->ulRxInjected % uwEvery))
+					s_ubExtraNext |= (1 << ubExtra);
+			}
+		}
+		encsimInjectFrame(pFrame, uwSize);
+		s_ullNextInject = ullNow + (s_sConfig.ulWireGap ?
+			s_sConfig.ulWireGap :
+			(uint32_t)(uwSize + BENCH_WIRE_OVERHEAD) * 16
+		);
+	}
+
+	if(benchIsDone()) {
+		pStats->ullEndCycles = ullNow;
+		halExit();
+	}
+}
+
+void benchInit(const tBenchConfig *pConfig) {
+	s_sConfig = *pConfig;
+	if(s_sConfig.uwFrameSize < BENCH_MIN_SIZE)
+		s_sConfig.uwFrameSize = BENCH_MIN_SIZE;
+	if(s_sConfig.uwFrameSize > DATABUF_SIZE)
+		s_sConfig.uwFrameSize = DATABUF_SIZE;
+	memset(&g_sBenchStats, 0, sizeof(g_sBenchStats));
+	if(s_sConfig.ubTxSlots) {
+		// Board set up earlier by pliptool, firmware picks it up from EEPROM
+		configReset();
+		g_sConfig.tx_slots = s_sConfig.ubTxSlots;
+		configSaveToRom();
+	}
+	encsimSetTxFaults(s_sConfig.uwTxFaultEvery);
+	encsimSetTxStuck(s_sConfig.uwTxStuckNth);
+	encsimSetTxSlowdown(s_sConfig.ubTxSlowdown);
+	encsimSetRxFaults(s_sConfig.uwRxFaultEvery);
+	s_ubOnlineSent = 0;
+	s_ubCmdNext = 0;
+	s_ubNeighReplyNext = 0;
+	s_ubCmdPending = 0;
+	s_ubExtraNext = 0;
+	s_uwArpOwed = 0;
+	s_ulArpSent = 0;
+	s_ubEchoOwedHead = 0;
+	s_ubEchoOwedCount = 0;
+	s_ulEchoSent = 0;
+	s_uwProtoFlags = 0;
+	s_ulTxQueued = 0;
+	s_ullNextInject = 0;
+	s_ullNextLinkChange = 0;
+	s_ubLinkDown = 0;
+	s_ubAmigaLinkDown = 0;
+	s_ubDepth = 0;
+}
+
+// ---------- Stage measurement ----------
+
+static void benchStageEnter(void) {
+	tStageCtx *pCtx = &s_pStack[s_ubDepth++];
+	pCtx->ullStart = halGetCycles();
+	pCtx->ullChildren = 0;
+}
+
+/**
+ * Ends stage measurement.
+ * @param ubIsCall 0 if cycles belong to call already counted, e.g. to frame
+ *        whose streaming has started earlier.
+ */
+static void benchStageLeaveCall(
+	uint8_t ubStage, uint16_t uwBytes, uint8_t ubIsCall
+) {
+	tStageCtx *pCtx = &s_pStack[--s_ubDepth];
+	uint64_t ullElapsed = halGetCycles() - pCtx->ullStart;
+	tBenchStage *pStage = &g_sBenchStats.pStages[ubStage];
+	pStage->ulCalls += ubIsCall;
+	pStage->ullCycles += ullElapsed - pCtx->ullChildren;
+	pStage->ullBytes += uwBytes;
+	if(s_ubDepth)
+		s_pStack[s_ubDepth - 1].ullChildren += ullElapsed;
+}
+
+static void benchStageLeave(uint8_t ubStage, uint16_t uwBytes) {
+	benchStageLeaveCall(ubStage, uwBytes, 1);
+}
+
+uint8_t __real_pb_proto_handle(void);
+uint8_t __wrap_pb_proto_handle(void) {
+	benchStageEnter();
+	uint8_t ubResult = __real_pb_proto_handle();
+	uint8_t ubStage;
+	if(ubResult == PBPROTO_STATUS_IDLE)
+		ubStage = BENCH_STAGE_PAR_IDLE;
+	else if(pb_proto_stat.is_send)
+		ubStage = BENCH_STAGE_PAR_TX;
+	else
+		ubStage = BENCH_STAGE_PAR_RX;
+	benchStageLeave(ubStage, pb_proto_stat.size);
+	return ubResult;
+}
+
+uint8_t __real_enc28j60_has_recv(void);
+uint8_t __wrap_enc28j60_has_recv(void) {
+	benchStageEnter();
+	uint8_t ubResult = __real_enc28j60_has_recv();
+	benchStageLeave(BENCH_STAGE_ENC_POLL, 0);
+	return ubResult;
+}
+
+uint8_t __real_enc28j60_recv(uint8_t *data, uint16_t max_size, uint16_t *got_size);
+uint8_t __wrap_enc28j60_recv(uint8_t *data, uint16_t max_size, uint16_t *got_size) {
+	benchStageEnter();
+	uint8_t ubResult = __real_enc28j60_recv(data, max_size, got_size);
+	benchStageLeave(BENCH_STAGE_ENC_RX, *got_size);
+	return ubResult;
+}
+
+uint8_t __real_enc28j60_send(const uint8_t *data, uint16_t size);
+uint8_t __wrap_enc28j60_send(const uint8_t *data, uint16_t size) {
+	benchStageEnter();
+	uint8_t ubResult = __real_enc28j60_send(data, size);
+	benchStageLeave(BENCH_STAGE_ENC_TX, size);
+	return ubResult;
+}
+
+uint8_t __real_enc28j60_recv_stream_begin(uint16_t *got_size);
+uint8_t __wrap_enc28j60_recv_stream_begin(uint16_t *got_size) {
+	benchStageEnter();
+	uint8_t ubResult = __real_enc28j60_recv_stream_begin(got_size);
+	benchStageLeave(BENCH_STAGE_ENC_RX_STREAM, 0);
+	return ubResult;
+}
+
+void __real_enc28j60_recv_stream_end(void);
+void __wrap_enc28j60_recv_stream_end(void) {
+	benchStageEnter();
+	__real_enc28j60_recv_stream_end();
+	benchStageLeaveCall(BENCH_STAGE_ENC_RX_STREAM, 0, 0);
+}
+
+void __real_enc28j60_send_stream_begin(uint8_t hdr_room);
+void __wrap_enc28j60_send_stream_begin(uint8_t hdr_room) {
+	benchStageEnter();
+	__real_enc28j60_send_stream_begin(hdr_room);
+	benchStageLeaveCall(BENCH_STAGE_ENC_TX_STREAM, 0, 0);
+}
+
+void __real_enc28j60_send_stream_end(void);
+void __wrap_enc28j60_send_stream_end(void) {
+	benchStageEnter();
+	__real_enc28j60_send_stream_end();
+	benchStageLeaveCall(BENCH_STAGE_ENC_TX_STREAM, 0, 0);
+}
+
+uint8_t __real_enc28j60_send_stream_commit(const uint8_t *data, uint16_t size);
+uint8_t __wrap_enc28j60_send_stream_commit(const uint8_t *data, uint16_t size) {
+	benchStageEnter();
+	uint8_t ubResult = __real_enc28j60_send_stream_commit(data, size);
+	benchStageLeave(BENCH_STAGE_ENC_TX_STREAM, 0);
+	return ubResult;
+}
@@ -0,0 +1,680 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#include <host/encsim.h>
+#include <string.h>
+#include <main/global.h>
+#include <host/hal.h>
+#include <host/bench.h>
+
+#define ENC_MEM_SIZE 0x2000
+#define ENC_MEM_MASK (ENC_MEM_SIZE-1)
+
+/// 10Mbit wire: 0.8us per byte
+#define ENC_WIRE_BYTE_CYCLES (F_CPU / 1250000UL)
+/// Preamble + SFD, CRC and inter-frame gap
+#define ENC_WIRE_OVERHEAD (8 + 4 + 12)
+#define ENC_MIN_FRAME 60
+/// DMA checksum pace - datasheet gives none, so one byte per 4 clocks of 25MHz
+#define ENC_DMA_BYTES_PER_SEC 6250000UL
+#define ENC_MAX_FRAME 1518
+
+// SPI opcodes (3 upper bits)
+#define OP_RCR 0x00
+#define OP_RBM 0x20
+#define OP_WCR 0x40
+#define OP_WBM 0x60
+#define OP_BFS 0x80
+#define OP_BFC 0xA0
+#define OP_SRC 0xE0
+
+// Bank 0
+#define ERDPTL   0x00
+#define EWRPTL   0x02
+#define ETXSTL   0x04
+#define ETXNDL   0x06
+#define ERXSTL   0x08
+#define ERXSTH   0x09
+#define ERXNDL   0x0A
+#define ERXRDPTL 0x0C
+#define ERXWRPTL 0x0E
+#define EDMASTL  0x10
+#define EDMANDL  0x12
+#define EDMADSTL 0x14
+#define EDMACSL  0x16
+// Bank 1
+#define EHT0     0x00
+#define EPMM0    0x08
+#define EPMCSL   0x10
+#define EPMOL    0x14
+#define ERXFCON  0x18
+#define EPKTCNT  0x19
+// Bank 2
+#define MICMD    0x12
+#define MIREGADR 0x14
+#define MIWRL    0x16
+#define MIWRH    0x17
+#define MIRDL    0x18
+#define MIRDH    0x19
+// Bank 3
+#define MISTAT   0x0A
+#define EREVID   0x12
+// Common
+#define EIE      0x1B
+#define EIR      0x1C
+#define ESTAT    0x1D
+#define ECON2    0x1E
+#define ECON1    0x1F
+
+#define EIR_PKTIF    0x40
+#define EIR_DMAIF    0x20
+#define EIR_LINKIF   0x10
+#define EIR_TXIF     0x08
+#define EIR_TXERIF   0x02
+#define EIR_RXERIF   0x01
+#define EIE_INTIE    0x80
+#define ESTAT_INT    0x80
+#define ESTAT_LATECOL 0x10
+#define ESTAT_TXABRT 0x02
+#define ESTAT_CLKRDY 0x01
+#define ECON2_AUTOINC 0x80
+#define ECON2_PKTDEC  0x40
+#define ECON1_TXRST  0x80
+#define ECON1_RXRST  0x40
+#define ECON1_DMAST  0x20
+#define ECON1_CSUMEN 0x10
+#define ECON1_TXRTS  0x08
+#define ECON1_RXEN   0x04
+#define ECON1_BSEL   0x03
+#define MICMD_MIIRD  0x01
+
+#define ERXFCON_UCEN  0x80
+#define ERXFCON_ANDOR 0x40
+#define ERXFCON_PMEN  0x10
+#define ERXFCON_MPEN  0x08
+#define ERXFCON_HTEN  0x04
+#define ERXFCON_MCEN  0x02
+#define ERXFCON_BCEN  0x01
+#define ERXFCON_FILTERS (ERXFCON_UCEN | ERXFCON_PMEN | ERXFCON_MPEN | \
+	ERXFCON_HTEN | ERXFCON_MCEN | ERXFCON_BCEN)
+
+/// Pattern match window size
+#define ENC_PATTERN_SIZE 64
+
+#define PHSTAT1 0x01
+#define PHHID1  0x02
+#define PHHID2  0x03
+#define PHSTAT2 0x11
+#define PHIE    0x12
+#define PHIR    0x13
+#define PHSTAT1_LLSTAT 0x0004
+#define PHSTAT2_LSTAT  0x0400
+#define PHIE_PLNKIE    0x0010
+#define PHIE_PGEIE     0x0002
+#define PHIR_PLNKIF    0x0010
+#define PHIR_PGIF      0x0004
+
+tEncsimStats g_sEncsimStats;
+
+static uint8_t s_pMem[ENC_MEM_SIZE];
+static uint8_t s_pRegs[4][0x20]; ///< Common registers are kept in bank 0.
+static uint16_t s_pPhy[0x20];
+
+static uint8_t s_ubSelected;
+static uint8_t s_ubOp;
+static uint8_t s_ubArg;
+static uint16_t s_uwByteIdx;
+
+static uint8_t s_ubTxBusy;
+static uint64_t s_ullTxEnd;
+static uint8_t s_pTxFrame[ENC_MAX_FRAME];
+static uint16_t s_uwTxSize;
+static uint16_t s_uwTxFaultEvery;
+static uint32_t s_ulTxAttempts;
+static uint16_t s_uwTxStuckNth;
+static uint32_t s_ulTxStarts;
+static uint8_t s_ubTxSlowdown = 1;
+static uint16_t s_uwRxFaultEvery;
+static uint8_t s_ubLinkUp;
+
+static uint8_t s_ubDmaBusy;
+static uint64_t s_ullDmaEnd;
+
+// ---------- Registers ----------
+
+static uint8_t *encsimReg(uint8_t ubBank, uint8_t ubAddr) {
+	if(ubAddr >= EIE)
+		return &s_pRegs[0][ubAddr];
+	return &s_pRegs[ubBank][ubAddr];
+}
+
+static uint16_t encsimGet16(uint8_t ubBank, uint8_t ubAddr) {
+	return s_pRegs[ubBank][ubAddr] | (s_pRegs[ubBank][ubAddr+1] << 8);
+}
+
+static void encsimSet16(uint8_t ubBank, uint8_t ubAddr, uint16_t uwValue) {
+	s_pRegs[ubBank][ubAddr] = uwValue & 0xFF;
+	s_pRegs[ubBank][ubAddr+1] = uwValue >> 8;
+}
+
+static uint8_t encsimBank(void) {
+	return s_pRegs[0][ECON1] & ECON1_BSEL;
+}
+
+/// MAC & MII registers shift out dummy byte before actual value.
+static uint8_t encsimIsMacMii(uint8_t ubBank, uint8_t ubAddr) {
+	if(ubAddr >= EIE)
+		return 0;
+	if(ubBank == 2)
+		return ubAddr <= MIRDH;
+	if(ubBank == 3)
+		return ubAddr <= 0x05 || ubAddr == MISTAT;
+	return 0;
+}
+
+static uint8_t encsimEir(void) {
+	uint8_t ubEir = s_pRegs[0][EIR] & ~EIR_PKTIF;
+	if(s_pRegs[1][EPKTCNT])
+		ubEir |= EIR_PKTIF;
+	if(s_pPhy[PHIR] & PHIR_PGIF)
+		ubEir |= EIR_LINKIF;
+	return ubEir;
+}
+
+uint8_t encsimIsIntActive(void) {
+	uint8_t ubEie = s_pRegs[0][EIE];
+	return (ubEie & EIE_INTIE) && (encsimEir() & ubEie & 0x7F);
+}
+
+static uint8_t encsimReadReg(uint8_t ubAddr) {
+	uint8_t ubBank = encsimBank();
+	switch(ubAddr) {
+		case EIR:
+			return encsimEir();
+		case ESTAT:
+			return (s_pRegs[0][ESTAT] & ~ESTAT_INT) | ESTAT_CLKRDY |
+				(encsimIsIntActive() ? ESTAT_INT : 0);
+	}
+	if(ubBank == 3 && ubAddr == MISTAT)
+		return 0; // MII operations complete instantly
+	return *encsimReg(ubBank, ubAddr);
+}
+
+static void encsimTxStart(void);
+static void encsimRxReset(void);
+static void encsimDmaStart(void);
+
+static void encsimWriteReg(uint8_t ubAddr, uint8_t ubValue) {
+	uint8_t ubBank = encsimBank();
+	if(ubAddr >= EIE) {
+		uint8_t ubOld = s_pRegs[0][ubAddr];
+		switch(ubAddr) {
+			case ECON2:
+				if((ubValue & ECON2_PKTDEC) && s_pRegs[1][EPKTCNT])
+					--s_pRegs[1][EPKTCNT];
+				ubValue &= ~ECON2_PKTDEC;
+				break;
+			case ECON1:
+				if(ubValue & ECON1_TXRST) {
+					s_ubTxBusy = 0;
+					ubValue &= ~ECON1_TXRTS;
+				}
+				if(ubValue & ECON1_RXRST)
+					encsimRxReset();
+				break;
+		}
+		s_pRegs[0][ubAddr] = ubValue;
+		if(
+			ubAddr == ECON1 && !(ubOld & ECON1_TXRTS) &&
+			(ubValue & ECON1_TXRTS) && !(ubValue & ECON1_TXRST)
+		) {
+			encsimTxStart();
+		}
+		if(ubAddr == ECON1 && !(ubOld & ECON1_DMAST) && (ubValue & ECON1_DMAST))
+			encsimDmaStart();
+		return;
+	}
+
+	s_pRegs[ubBank][ubAddr] = ubValue;
+	if(ubBank == 0 && ubAddr == ERXSTH) {
+		// Write pointer follows RX start
+		encsimSet16(0, ERXWRPTL, encsimGet16(0, ERXSTL));
+	}
+	else if(ubBank == 1 && ubAddr == EPKTCNT) {
+		// Read-only
+	}
+	else if(ubBank == 2 && ubAddr == MICMD && (ubValue & MICMD_MIIRD)) {
+		uint8_t ubPhyAddr = s_pRegs[2][MIREGADR] & 0x1F;
+		encsimSet16(2, MIRDL, s_pPhy[ubPhyAddr]);
+		// Reading PHIR clears its flags, and LINKIF along
+		if(ubPhyAddr == PHIR)
+			s_pPhy[PHIR] = 0;
+	}
+	else if(ubBank == 2 && ubAddr == MIWRH) {
+		s_pPhy[s_pRegs[2][MIREGADR] & 0x1F] = encsimGet16(2, MIWRL);
+	}
+}
+
+// ---------- Buffer memory ----------
+
+static uint16_t encsimRxWrap(uint16_t uwPtr) {
+	uint16_t uwStart = encsimGet16(0, ERXSTL);
+	uint16_t uwEnd = encsimGet16(0, ERXNDL);
+	if(uwPtr > uwEnd)
+		uwPtr = uwStart + (uwPtr - uwEnd - 1);
+	return uwPtr;
+}
+
+static uint8_t encsimReadBufByte(void) {
+	uint16_t uwPtr = encsimGet16(0, ERDPTL);
+	uint8_t ubValue = s_pMem[uwPtr & ENC_MEM_MASK];
+	if(s_pRegs[0][ECON2] & ECON2_AUTOINC) {
+		if(uwPtr == encsimGet16(0, ERXNDL))
+			uwPtr = encsimGet16(0, ERXSTL);
+		else
+			uwPtr = (uwPtr + 1) & ENC_MEM_MASK;
+		encsimSet16(0, ERDPTL, uwPtr);
+	}
+	return ubValue;
+}
+
+static void encsimWriteBufByte(uint8_t ubValue) {
+	uint16_t uwPtr = encsimGet16(0, EWRPTL);
+	s_pMem[uwPtr & ENC_MEM_MASK] = ubValue;
+	if(s_pRegs[0][ECON2] & ECON2_AUTOINC)
+		encsimSet16(0, EWRPTL, (uwPtr + 1) & ENC_MEM_MASK);
+}
+
+// ---------- Reset ----------
+
+static void encsimRxReset(void) {
+	s_pRegs[1][EPKTCNT] = 0;
+	encsimSet16(0, ERXWRPTL, encsimGet16(0, ERXSTL));
+}
+
+static void encsimReset(void) {
+	memset(s_pRegs, 0, sizeof(s_pRegs));
+	memset(s_pPhy, 0, sizeof(s_pPhy));
+	encsimSet16(0, ERDPTL, 0x05FA);
+	encsimSet16(0, ERXNDL, 0x1FFF);
+	encsimSet16(0, ERXRDPTL, 0x05FA);
+	s_pRegs[1][ERXFCON] = 0xA1;
+	s_pRegs[3][EREVID] = 0x06;
+	s_pRegs[0][ECON2] = ECON2_AUTOINC;
+	s_pRegs[0][ESTAT] = ESTAT_CLKRDY;
+	s_pPhy[PHHID1] = 0x0083;
+	s_pPhy[PHHID2] = 0x1400;
+	// Link depends on cable, not on reset
+	s_pPhy[PHSTAT1] = s_ubLinkUp ? PHSTAT1_LLSTAT : 0;
+	s_pPhy[PHSTAT2] = s_ubLinkUp ? PHSTAT2_LSTAT : 0;
+	s_ubTxBusy = 0;
+	s_ubDmaBusy = 0;
+}
+
+// ---------- SPI ----------
+
+void encsimSelect(uint8_t ubSelected) {
+	s_ubSelected = ubSelected;
+	s_uwByteIdx = 0;
+}
+
+uint8_t encsimSpiXfer(uint8_t ubMosi) {
+	if(!s_ubSelected)
+		return 0xFF;
+
+	uint16_t uwIdx = s_uwByteIdx++;
+	if(uwIdx == 0) {
+		s_ubOp = ubMosi & 0xE0;
+		s_ubArg = ubMosi & 0x1F;
+		if(s_ubOp == OP_SRC)
+			encsimReset();
+		return 0;
+	}
+
+	uint8_t ubBank = encsimBank();
+	switch(s_ubOp) {
+		case OP_RCR:
+			if(encsimIsMacMii(ubBank, s_ubArg) && uwIdx == 1)
+				return 0;
+			return encsimReadReg(s_ubArg);
+		case OP_RBM:
+			return encsimReadBufByte();
+		case OP_WCR:
+			if(uwIdx == 1)
+				encsimWriteReg(s_ubArg, ubMosi);
+			return 0;
+		case OP_WBM:
+			encsimWriteBufByte(ubMosi);
+			return 0;
+		case OP_BFS:
+			if(uwIdx == 1 && s_ubArg >= EIE)
+				encsimWriteReg(s_ubArg, s_pRegs[0][s_ubArg] | ubMosi);
+			else if(uwIdx == 1 && !encsimIsMacMii(ubBank, s_ubArg))
+				encsimWriteReg(s_ubArg, s_pRegs[ubBank][s_ubArg] | ubMosi);
+			return 0;
+		case OP_BFC:
+			if(uwIdx == 1 && s_ubArg >= EIE)
+				encsimWriteReg(s_ubArg, s_pRegs[0][s_ubArg] & ~ubMosi);
+			else if(uwIdx == 1 && !encsimIsMacMii(ubBank, s_ubArg))
+				encsimWriteReg(s_ubArg, s_pRegs[ubBank][s_ubArg] & ~ubMosi);
+			return 0;
+	}
+	return 0;
+}
+
+// ---------- Transmit ----------
+
+static void encsimTxStart(void) {
+	uint16_t uwStart = encsimGet16(0, ETXSTL);
+	uint16_t uwEnd = encsimGet16(0, ETXNDL);
+	uint16_t uwSize = (uwEnd - uwStart) & ENC_MEM_MASK;
+
+	if(uwSize == 0 || uwSize > ENC_MAX_FRAME) {
+		s_pRegs[0][EIR] |= EIR_TXERIF;
+		s_pRegs[0][ECON1] &= ~ECON1_TXRTS;
+		return;
+	}
+	s_pRegs[0][ESTAT] &= ~ESTAT_LATECOL;
+
+	// Skip per-packet control byte
+	for(uint16_t i = 0; i < uwSize; ++i)
+		s_pTxFrame[i] = s_pMem[(uwStart + 1 + i) & ENC_MEM_MASK];
+	s_uwTxSize = uwSize;
+
+	uint16_t uwWireSize = uwSize < ENC_MIN_FRAME ? ENC_MIN_FRAME : uwSize;
+	s_ullTxEnd = halGetCycles() + (uint64_t)(uwWireSize + ENC_WIRE_OVERHEAD) *
+		ENC_WIRE_BYTE_CYCLES * s_ubTxSlowdown;
+	if(s_uwTxStuckNth && ++s_ulTxStarts == s_uwTxStuckNth) {
+		// Hung TX logic - only TXRST gets it going again
+		s_ullTxEnd = UINT64_MAX;
+		++g_sEncsimStats.ulTxStuck;
+	}
+	s_ubTxBusy = 1;
+}
+
+static void encsimTxFinish(void) {
+	s_ubTxBusy = 0;
+	s_pRegs[0][ECON1] &= ~ECON1_TXRTS;
+	if(s_uwTxFaultEvery && !(++s_ulTxAttempts % s_uwTxFaultEvery)) {
+		// Late collision - frame gets aborted and never reaches the other end
+		s_pRegs[0][ESTAT] |= ESTAT_LATECOL | ESTAT_TXABRT;
+		s_pRegs[0][EIR] |= EIR_TXERIF;
+		++g_sEncsimStats.ulTxAborted;
+		return;
+	}
+
+	uint16_t uwEnd = encsimGet16(0, ETXNDL);
+	uint8_t pTsv[7] = {
+		s_uwTxSize & 0xFF, s_uwTxSize >> 8, 0x80, 0, 0, 0, 0
+	};
+	for(uint8_t i = 0; i < sizeof(pTsv); ++i)
+		s_pMem[(uwEnd + 1 + i) & ENC_MEM_MASK] = pTsv[i];
+
+	s_pRegs[0][EIR] |= EIR_TXIF;
+	if(!s_ubLinkUp) {
+		// Sent fine as far as chip knows, but nobody got it
+		++g_sEncsimStats.ulTxNoLink;
+		return;
+	}
+	++g_sEncsimStats.ulTxFrames;
+	g_sEncsimStats.ullTxBytes += s_uwTxSize;
+	benchOnWireFrame(s_pTxFrame, s_uwTxSize);
+}
+
+uint8_t encsimIsTxBusy(void) {
+	return s_ubTxBusy;
+}
+
+void encsimSetTxFaults(uint16_t uwEvery) {
+	s_uwTxFaultEvery = uwEvery;
+	s_ulTxAttempts = 0;
+}
+
+void encsimSetTxStuck(uint16_t uwNth) {
+	s_uwTxStuckNth = uwNth;
+	s_ulTxStarts = 0;
+}
+
+void encsimSetTxSlowdown(uint8_t ubTimes) {
+	s_ubTxSlowdown = ubTimes ? ubTimes : 1;
+}
+
+void encsimSetRxFaults(uint16_t uwEvery) {
+	s_uwRxFaultEvery = uwEvery;
+}
+
+// ---------- DMA ----------
+
+/**
+ * Starts DMA checksum or copy of EDMAST..EDMAND, copy going to EDMADST.
+ * Ranges in RX buffer wrap at its end, like ERDPT. Result is ready right away,
+ * but DMAST stays set for time which it would take on chip.
+ */
+static void encsimDmaStart(void) {
+	uint8_t ubCsum = s_pRegs[0][ECON1] & ECON1_CSUMEN;
+	uint16_t uwPtr = encsimGet16(0, EDMASTL) & ENC_MEM_MASK;
+	uint16_t uwEnd = encsimGet16(0, EDMANDL) & ENC_MEM_MASK;
+	uint16_t uwDst = encsimGet16(0, EDMADSTL) & ENC_MEM_MASK;
+	uint16_t uwRxStart = encsimGet16(0, ERXSTL);
+	uint16_t uwRxEnd = encsimGet16(0, ERXNDL);
+	uint8_t ubInRx = uwPtr >= uwRxStart && uwPtr <= uwRxEnd;
+	uint8_t ubDstInRx = uwDst >= uwRxStart && uwDst <= uwRxEnd;
+	uint32_t ulSum = 0;
+	uint16_t uwLength = 0;
+	while(1) {
+		if(ubCsum)
+			ulSum += (uwLength & 1) ? s_pMem[uwPtr] : (s_pMem[uwPtr] << 8);
+		else {
+			s_pMem[uwDst] = s_pMem[uwPtr];
+			uwDst = ubDstInRx ? encsimRxWrap(uwDst + 1) : ((uwDst + 1) & ENC_MEM_MASK);
+		}
+		++uwLength;
+		if(uwPtr == uwEnd || uwLength == ENC_MEM_SIZE)
+			break;
+		uwPtr = ubInRx ? encsimRxWrap(uwPtr + 1) : ((uwPtr + 1) & ENC_MEM_MASK);
+	}
+	if(ubCsum) {
+		while(ulSum >> 16)
+			ulSum = (ulSum & 0xFFFF) + (ulSum >> 16);
+		ulSum = ~ulSum & 0xFFFF;
+		// First byte of big endian checksum goes to EDMACSH
+		encsimSet16(0, EDMACSL, ulSum);
+	}
+
+	s_ullDmaEnd = halGetCycles() + (uint64_t)uwLength * F_CPU / ENC_DMA_BYTES_PER_SEC;
+	s_ubDmaBusy = 1;
+	++g_sEncsimStats.ulDmaRuns;
+}
+
+void encsimTick(void) {
+	if(s_ubTxBusy && halGetCycles() >= s_ullTxEnd)
+		encsimTxFinish();
+	if(s_ubDmaBusy && halGetCycles() >= s_ullDmaEnd) {
+		s_ubDmaBusy = 0;
+		s_pRegs[0][ECON1] &= ~ECON1_DMAST;
+		s_pRegs[0][EIR] |= EIR_DMAIF;
+	}
+}
+
+// ---------- Receive ----------
+
+/**
+ * Checks destination MAC against hash table.
+ * Table bit is selected by bits 28:23 of CRC-32 of destination MAC.
+ */
+static uint8_t encsimRxHashMatch(const uint8_t *pData) {
+	uint32_t ulCrc = 0xFFFFFFFF;
+	for(uint8_t i = 0; i < 6; ++i) {
+		uint8_t ubByte = pData[i];
+		for(uint8_t j = 0; j < 8; ++j) {
+			uint8_t ubNext = (ulCrc >> 31) ^ (ubByte & 1);
+			ulCrc <<= 1;
+			if(ubNext)
+				ulCrc ^= 0x04C11DB7;
+			ubByte >>= 1;
+		}
+	}
+	uint8_t ubBit = (ulCrc >> 23) & 0x3F;
+	return (s_pRegs[1][EHT0 + (ubBit >> 3)] >> (ubBit & 7)) & 1;
+}
+
+/**
+ * Checks IP checksum of bytes selected by EPMM in window starting at EPMO.
+ */
+static uint8_t encsimRxPatternMatch(const uint8_t *pData, uint16_t uwSize) {
+	uint16_t uwOffs = encsimGet16(1, EPMOL) & ENC_MEM_MASK;
+	if(uwOffs + ENC_PATTERN_SIZE > uwSize)
+		return 0;
+	uint32_t ulSum = 0;
+	uint8_t ubHigh = 1;
+	for(uint8_t i = 0; i < ENC_PATTERN_SIZE; ++i) {
+		if(!((s_pRegs[1][EPMM0 + (i >> 3)] >> (i & 7)) & 1))
+			continue;
+		ulSum += ubHigh ? (pData[uwOffs + i] << 8) : pData[uwOffs + i];
+		ubHigh = !ubHigh;
+	}
+	while(ulSum >> 16)
+		ulSum = (ulSum & 0xFFFF) + (ulSum >> 16);
+	return (uint16_t)~ulSum == encsimGet16(1, EPMCSL);
+}
+
+static uint8_t encsimRxFilter(const uint8_t *pData, uint16_t uwSize) {
+	uint8_t ubFilter = s_pRegs[1][ERXFCON];
+	if(!(ubFilter & ERXFCON_FILTERS))
+		return 1;
+
+	const uint8_t pMac[6] = {
+		s_pRegs[3][0x04], s_pRegs[3][0x05], s_pRegs[3][0x02],
+		s_pRegs[3][0x03], s_pRegs[3][0x00], s_pRegs[3][0x01]
+	};
+	static const uint8_t pBcast[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+	uint8_t ubIsBcast = !memcmp(pData, pBcast, 6);
+	uint8_t ubIsMcast = !ubIsBcast && (pData[0] & 1);
+	uint8_t ubIsUcast = !memcmp(pData, pMac, 6);
+
+	uint8_t ubAnd = (ubFilter & ERXFCON_ANDOR) != 0;
+	uint8_t ubResult = ubAnd;
+	if(ubFilter & ERXFCON_UCEN)
+		ubResult = ubAnd ? (ubResult && ubIsUcast) : (ubResult || ubIsUcast);
+	if(ubFilter & ERXFCON_MCEN)
+		ubResult = ubAnd ? (ubResult && ubIsMcast) : (ubResult || ubIsMcast);
+	if(ubFilter & ERXFCON_BCEN)
+		ubResult = ubAnd ? (ubResult && ubIsBcast) : (ubResult || ubIsBcast);
+	if(ubFilter & ERXFCON_HTEN) {
+		uint8_t ubHash = encsimRxHashMatch(pData);
+		ubResult = ubAnd ? (ubResult && ubHash) : (ubResult || ubHash);
+	}
+	if(ubFilter & ERXFCON_PMEN) {
+		uint8_t ubPattern = encsimRxPatternMatch(pData, uwSize);
+		ubResult = ubAnd ? (ubResult && ubPattern) : (ubResult || ubPattern);
+	}
+	// Wake-on-LAN magic packets aren't modelled, so MPEN never matches
+	if(ubFilter & ERXFCON_MPEN)
+		ubResult = ubAnd ? 0 : ubResult;
+	return ubResult;
+}
+
+static uint16_t encsimRxFree(void) {
+	uint16_t uwStart = encsimGet16(0, ERXSTL);
+	uint16_t uwEnd = encsimGet16(0, ERXNDL);
+	uint16_t uwWr = encsimGet16(0, ERXWRPTL);
+	uint16_t uwRd = encsimGet16(0, ERXRDPTL);
+	if(uwWr > uwRd)
+		return (uwEnd - uwStart) - (uwWr - uwRd);
+	if(uwWr == uwRd)
+		return uwEnd - uwStart;
+	return uwRd - uwWr - 1;
+}
+
+static uint16_t encsimRxPut(uint16_t uwPtr, uint8_t ubValue) {
+	s_pMem[uwPtr & ENC_MEM_MASK] = ubValue;
+	return encsimRxWrap(uwPtr + 1);
+}
+
+uint8_t encsimInjectFrame(const uint8_t *pData, uint16_t uwSize) {
+	if(!(s_pRegs[0][ECON1] & ECON1_RXEN) || !s_ubLinkUp) {
+		++g_sEncsimStats.ulRxMissed;
+		return 0;
+	}
+	if(!encsimRxFilter(pData, uwSize)) {
+		++g_sEncsimStats.ulRxFiltered;
+		return 0;
+	}
+
+	uint16_t uwWireSize = uwSize < ENC_MIN_FRAME ? ENC_MIN_FRAME : uwSize;
+	uint16_t uwNeeded = (6 + uwWireSize + 4 + 1) & ~1;
+	if(uwNeeded > encsimRxFree() || s_pRegs[1][EPKTCNT] == 0xFF) {
+		s_pRegs[0][EIR] |= EIR_RXERIF;
+		++g_sEncsimStats.ulRxOverflows;
+		return 0;
+	}
+
+	uint16_t uwPtr = encsimGet16(0, ERXWRPTL);
+	uint16_t uwNext = encsimRxWrap(uwPtr + uwNeeded);
+	uint16_t uwHdr = uwPtr;
+	uint16_t uwCount = uwWireSize + 4;
+	uint8_t ubStatusHi = (pData[0] & 1) ? ((pData[0] == 0xFF) ? 0x02 : 0x01) : 0;
+
+	uwPtr = encsimRxPut(uwPtr, uwNext & 0xFF);
+	uwPtr = encsimRxPut(uwPtr, uwNext >> 8);
+	uwPtr = encsimRxPut(uwPtr, uwCount & 0xFF);
+	uwPtr = encsimRxPut(uwPtr, uwCount >> 8);
+	uwPtr = encsimRxPut(uwPtr, 0x80); // Received OK
+	uwPtr = encsimRxPut(uwPtr, ubStatusHi);
+	for(uint16_t i = 0; i < uwWireSize; ++i)
+		uwPtr = encsimRxPut(uwPtr, i < uwSize ? pData[i] : 0);
+	for(uint8_t i = 0; i < 4; ++i)
+		uwPtr = encsimRxPut(uwPtr, 0); // CRC isn't checked by firmware
+
+	encsimSet16(0, ERXWRPTL, uwNext);
+	++s_pRegs[1][EPKTCNT];
+	++g_sEncsimStats.ulRxFrames;
+
+	if(s_uwRxFaultEvery && !(g_sEncsimStats.ulRxFrames % s_uwRxFaultEvery)) {
+		// Garbage next packet pointer, as if buffer got corrupted
+		encsimRxPut(uwHdr, 0xFF);
+		encsimRxPut(encsimRxWrap(uwHdr + 1), 0xFF);
+	}
+
+	uint16_t uwUsed = (encsimGet16(0, ERXNDL) - encsimGet16(0, ERXSTL)) -
+		encsimRxFree();
+	if(uwUsed > g_sEncsimStats.uwRxPeak)
+		g_sEncsimStats.uwRxPeak = uwUsed;
+	return 1;
+}
+
+uint8_t encsimGetPktCnt(void) {
+	return s_pRegs[1][EPKTCNT];
+}
+
+// ---------- PHY ----------
+
+void encsimSetLink(uint8_t ubUp) {
+	if(ubUp == s_ubLinkUp)
+		return;
+	s_ubLinkUp = ubUp;
+	s_pPhy[PHIR] |= PHIR_PLNKIF;
+	if((s_pPhy[PHIE] & (PHIE_PGEIE | PHIE_PLNKIE)) == (PHIE_PGEIE | PHIE_PLNKIE))
+		s_pPhy[PHIR] |= PHIR_PGIF;
+	if(ubUp) {
+		s_pPhy[PHSTAT1] |= PHSTAT1_LLSTAT;
+		s_pPhy[PHSTAT2] |= PHSTAT2_LSTAT;
+	}
+	else {
+		s_pPhy[PHSTAT1] &= ~PHSTAT1_LLSTAT;
+		s_pPhy[PHSTAT2] &= ~PHSTAT2_LSTAT;
+	}
+}
+
+void encsimInit(void) {
+	memset(s_pMem, 0, sizeof(s_pMem));
+	memset(&g_sEncsimStats, 0, sizeof(g_sEncsimStats));
+	s_ubSelected = 0;
+	s_uwByteIdx = 0;
+	s_ubLinkUp = 1;
+	encsimReset();
+}
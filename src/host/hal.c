@@ -0,0 +1,332 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#include <host/hal.h>
+#include <string.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <main/global.h>
+#include <main/pinout.h>
+#include <host/amiga.h>
+#include <host/encsim.h>
+#include <host/bench.h>
+
+/**
+ * Register access model.
+ * Firmware gets pointer to register cell and performs read or write on its
+ * own, so HAL can't tell what happened until next access. Because of that,
+ * every access first post-processes previous one: written outputs are
+ * propagated to peers by comparing cells against last propagated values.
+ *
+ * SPDR is the only register where writing the same value twice matters.
+ * Access while shifter is idle is treated as write. Access right after
+ * completed transfer may be a read of received byte or a write of next one:
+ * it's a write if next access polls SPSR, otherwise it's a read. Firmware
+ * must therefore wait for SPIF right after such write, which is what all
+ * blocking and pipelined SPI loops do anyway.
+ */
+
+#define HAL_REG_NONE   0xFF
+#define HAL_REG16_FLAG 0x80
+
+// SPI shifter states
+#define SPI_IDLE 0
+#define SPI_BUSY 1
+#define SPI_DONE 2
+
+tHalStats g_sHalStats;
+jmp_buf g_sHalExit;
+
+static volatile uint8_t s_pReg8[HAL_REG8_COUNT];
+static volatile uint16_t s_pReg16[HAL_REG16_COUNT];
+static uint8_t s_pLatch8[HAL_REG8_COUNT];   ///< Values already seen by peers.
+static uint16_t s_pLatch16[HAL_REG16_COUNT];
+
+static uint64_t s_ullCycles;
+static uint8_t s_ubLastReg;         ///< Register awaiting post-processing.
+static uint64_t s_ullLastAccess;    ///< Time of last register access.
+
+static uint8_t s_ubIrqEnabled;
+static uint8_t s_ubInIsr;
+static uint64_t s_ullIrqOffStart;
+
+static uint64_t s_ullTimerBase;      ///< Time at which TCNT1 was zero.
+static uint64_t s_ullTimerNextMatch; ///< Time of next OCR1A compare match.
+
+static uint8_t s_ubSpiState;
+static uint64_t s_ullSpiEnd;
+static uint8_t s_ubSpiMiso;
+static uint8_t s_ubEthSelected;
+
+// ---------- Timer ----------
+
+static uint8_t halTimerIsRunning(void) {
+	return (s_pReg8[HAL_TCCR1B] & (_BV(CS10) | _BV(CS11) | _BV(CS12))) != 0;
+}
+
+static void halTimerRecalc(void) {
+	s_ullTimerNextMatch = s_ullTimerBase + s_pReg16[HAL_OCR1A];
+	while(s_ullTimerNextMatch <= s_ullCycles)
+		s_ullTimerNextMatch += 0x10000;
+}
+
+static void halTimerUpdate(void) {
+	if(!halTimerIsRunning())
+		return;
+	while(s_ullCycles >= s_ullTimerNextMatch) {
+		s_pReg8[HAL_TIFR1] |= _BV(OCF1A);
+		s_ullTimerNextMatch += 0x10000;
+	}
+}
+
+// ---------- SPI ----------
+
+static void halSpiStart(uint64_t ullStart) {
+	uint8_t ubMosi = s_pReg8[HAL_SPDR];
+	if(s_ubEthSelected) {
+		s_ubSpiMiso = encsimSpiXfer(ubMosi);
+		++g_sHalStats.ullSpiBytes;
+	}
+	else
+		s_ubSpiMiso = 0xFF;
+	s_ullSpiEnd = ullStart + HAL_SPI_BYTE_CYCLES;
+	s_ubSpiState = SPI_BUSY;
+}
+
+static void halSpiUpdate(void) {
+	if(s_ubSpiState == SPI_BUSY && s_ullCycles >= s_ullSpiEnd) {
+		s_pReg8[HAL_SPDR] = s_ubSpiMiso;
+		s_ubSpiState = SPI_DONE;
+	}
+}
+
+// ---------- Interrupts ----------
+
+static void halFlush(uint8_t ubNextReg);
+
+static void halRunIsr(void (*pVector)(void)) {
+	uint8_t ubLastReg = s_ubLastReg;
+	uint64_t ullLastAccess = s_ullLastAccess;
+
+	s_ubLastReg = HAL_REG_NONE;
+	s_ubInIsr = 1;
+	s_ubIrqEnabled = 0;
+	++g_sHalStats.ulIsrCount;
+	s_ullCycles += HAL_ISR_CYCLES;
+	pVector();
+	halFlush(HAL_REG_NONE);
+	s_ubIrqEnabled = 1;
+	s_ubInIsr = 0;
+
+	s_ubLastReg = ubLastReg;
+	s_ullLastAccess = ullLastAccess;
+}
+
+static void halIrqDispatch(void) {
+	if(!s_ubIrqEnabled || s_ubInIsr)
+		return;
+	if(
+		(s_pReg8[HAL_TIFR1] & _BV(OCF1A)) &&
+		(s_pReg8[HAL_TIMSK1] & _BV(OCIE1A))
+	) {
+		s_pReg8[HAL_TIFR1] &= ~_BV(OCF1A);
+		halRunIsr(halVectTimer1CompA);
+	}
+}
+
+// ---------- Time ----------
+
+static void halAdvance(uint32_t ulCycles) {
+	while(ulCycles) {
+		uint32_t ulStep = ulCycles < HAL_ACCESS_CYCLES ? ulCycles : HAL_ACCESS_CYCLES;
+		ulCycles -= ulStep;
+		s_ullCycles += ulStep;
+		halTimerUpdate();
+		halSpiUpdate();
+		amigaTick();
+		encsimTick();
+		benchTick();
+		halIrqDispatch();
+	}
+}
+
+// ---------- Register access ----------
+
+static void halPropagateParallel(void) {
+	uint8_t ubStatus = s_pReg8[HAL_PORTC] & s_pReg8[HAL_DDRC];
+	amigaSetAvrLines(ubStatus, s_pReg8[HAL_PORTD], s_pReg8[HAL_DDRD]);
+}
+
+/**
+ * Post-processes last register access.
+ * @param ubNextReg Register which is about to be accessed.
+ */
+static void halFlush(uint8_t ubNextReg) {
+	uint8_t ubReg = s_ubLastReg;
+	s_ubLastReg = HAL_REG_NONE;
+	if(ubReg == HAL_REG_NONE)
+		return;
+
+	if(ubReg & HAL_REG16_FLAG) {
+		ubReg &= ~HAL_REG16_FLAG;
+		if(s_pReg16[ubReg] == s_pLatch16[ubReg])
+			return;
+		s_pLatch16[ubReg] = s_pReg16[ubReg];
+		if(ubReg == HAL_TCNT1) {
+			s_ullTimerBase = s_ullLastAccess - s_pReg16[HAL_TCNT1];
+			halTimerRecalc();
+		}
+		else if(ubReg == HAL_OCR1A)
+			halTimerRecalc();
+		return;
+	}
+
+	if(ubReg == HAL_SPDR) {
+		if(s_ubSpiState == SPI_IDLE)
+			halSpiStart(s_ullLastAccess);
+		else if(s_ubSpiState == SPI_DONE) {
+			// SPIF gets cleared by this access, decide if it was a write
+			s_ubSpiState = SPI_IDLE;
+			if(ubNextReg == HAL_SPSR)
+				halSpiStart(s_ullLastAccess);
+		}
+		return;
+	}
+
+	if(s_pReg8[ubReg] == s_pLatch8[ubReg])
+		return;
+	s_pLatch8[ubReg] = s_pReg8[ubReg];
+
+	switch(ubReg) {
+		case HAL_PORTB: {
+			uint8_t ubSelected = !(s_pReg8[HAL_PORTB] & ETH_CS);
+			if(ubSelected != s_ubEthSelected) {
+				s_ubEthSelected = ubSelected;
+				if(ubSelected)
+					++g_sHalStats.ulSpiSelects;
+				encsimSelect(ubSelected);
+			}
+		} break;
+		case HAL_PORTC:
+		case HAL_DDRC:
+		case HAL_PORTD:
+		case HAL_DDRD:
+			halPropagateParallel();
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * Refreshes input register before firmware reads it.
+ */
+static void halRefresh(uint8_t ubReg) {
+	switch(ubReg) {
+		case HAL_PINB:
+			s_pReg8[HAL_PINB] = (s_pReg8[HAL_PORTB] & s_pReg8[HAL_DDRB]) |
+				(~s_pReg8[HAL_DDRB] & 0xFF);
+#ifdef ETH_INT
+			if(encsimIsIntActive())
+				s_pReg8[HAL_PINB] &= ~ETH_INT;
+#endif
+			break;
+		case HAL_PINC:
+			s_pReg8[HAL_PINC] = (s_pReg8[HAL_PORTC] & s_pReg8[HAL_DDRC]) |
+				(amigaGetStatusLines() & ~s_pReg8[HAL_DDRC]);
+			break;
+		case HAL_PIND: {
+			uint8_t ubData;
+			if(!amigaGetDataLines(&ubData))
+				ubData = s_pReg8[HAL_PORTD]; // pull-ups or floating
+			s_pReg8[HAL_PIND] = (s_pReg8[HAL_PORTD] & s_pReg8[HAL_DDRD]) |
+				(ubData & ~s_pReg8[HAL_DDRD]);
+		} break;
+		case HAL_SPSR:
+			s_pReg8[HAL_SPSR] = (s_pReg8[HAL_SPSR] & _BV(SPI2X)) |
+				(s_ubSpiState == SPI_DONE ? _BV(SPIF) : 0);
+			break;
+		default:
+			break;
+	}
+}
+
+volatile uint8_t *halReg8(uint8_t ubReg) {
+	halFlush(ubReg);
+	++g_sHalStats.ullAccessCount;
+	halAdvance(HAL_ACCESS_CYCLES);
+	halRefresh(ubReg);
+	s_ubLastReg = ubReg;
+	s_ullLastAccess = s_ullCycles;
+	return &s_pReg8[ubReg];
+}
+
+volatile uint16_t *halReg16(uint8_t ubReg) {
+	halFlush(ubReg | HAL_REG16_FLAG);
+	++g_sHalStats.ullAccessCount;
+	halAdvance(HAL_ACCESS_CYCLES);
+	if(ubReg == HAL_TCNT1)
+		s_pReg16[HAL_TCNT1] = (uint16_t)(s_ullCycles - s_ullTimerBase);
+	else if(ubReg == HAL_SP)
+		s_pReg16[HAL_SP] = 0x08FF;
+	s_pLatch16[ubReg] = s_pReg16[ubReg];
+	s_ubLastReg = ubReg | HAL_REG16_FLAG;
+	s_ullLastAccess = s_ullCycles;
+	return &s_pReg16[ubReg];
+}
+
+// ---------- Misc ----------
+
+void halCli(void) {
+	if(s_ubIrqEnabled && !s_ubInIsr) {
+		s_ubIrqEnabled = 0;
+		s_ullIrqOffStart = s_ullCycles;
+	}
+}
+
+void halSei(void) {
+	if(!s_ubIrqEnabled && !s_ubInIsr) {
+		uint32_t ulWindow = s_ullCycles - s_ullIrqOffStart;
+		if(ulWindow > g_sHalStats.ulIrqOffMax)
+			g_sHalStats.ulIrqOffMax = ulWindow;
+		s_ubIrqEnabled = 1;
+	}
+}
+
+void halDelayCycles(uint32_t ulCycles) {
+	halAdvance(ulCycles);
+}
+
+void halIdle(void) {
+	halFlush(HAL_REG_NONE);
+	halAdvance(HAL_ACCESS_CYCLES);
+}
+
+void halExit(void) {
+	longjmp(g_sHalExit, 1);
+}
+
+uint64_t halGetCycles(void) {
+	return s_ullCycles;
+}
+
+void halInit(void) {
+	memset((void*)s_pReg8, 0, sizeof(s_pReg8));
+	memset((void*)s_pReg16, 0, sizeof(s_pReg16));
+	memset(s_pLatch8, 0, sizeof(s_pLatch8));
+	memset(s_pLatch16, 0, sizeof(s_pLatch16));
+	memset(&g_sHalStats, 0, sizeof(g_sHalStats));
+	s_ullCycles = 0;
+	s_ubLastReg = HAL_REG_NONE;
+	s_ullLastAccess = 0;
+	s_ubIrqEnabled = 0;
+	s_ubInIsr = 0;
+	s_ullTimerBase = 0;
+	s_ubSpiState = SPI_IDLE;
+	s_ubEthSelected = 0;
+	halTimerRecalc();
+}
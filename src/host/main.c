@@ -0,0 +1,311 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <main/global.h>
+#include <main/stats.h>
+#include <main/pb_proto.h>
+#include <host/hal.h>
+#include <host/amiga.h>
+#include <host/encsim.h>
+#include <host/bench.h>
+
+/**
+ * Host-native benchmark of plipUltimate firmware.
+ * Unmodified firmware sources run against simulated register file, Amiga
+ * peer and ENC28J60. Reported cycle counts come from HAL's access cost model,
+ * so treat them as estimates - they are good for comparing firmware changes
+ * with each other, not for predicting exact AVR timings.
+ */
+
+/// Firmware's main(), renamed by host.mk
+extern int firmwareMain(void);
+
+static const char * const s_pStageNames[BENCH_STAGE_COUNT] = {
+	"par idle", "par rx", "par tx", "enc poll", "enc rx", "enc tx",
+	"enc rx strm", "enc tx strm"
+};
+
+/// Settings of single run, filled from command line
+typedef struct _tBenchArgs {
+	tBenchConfig sConfig;
+	tAmigaTiming sTiming;
+	uint8_t ubBurst;
+} tBenchArgs;
+
+/// Numeric command line option, stored straight into tBenchArgs field
+typedef struct _tBenchOpt {
+	char cName;
+	const char *szArg;
+	const char *szHelp;
+	size_t ulOffs;
+	uint8_t ubSize;
+} tBenchOpt;
+
+#define BENCH_OPT(cName, szArg, szHelp, field) { \
+	cName, szArg, szHelp, offsetof(tBenchArgs, field), \
+	sizeof(((tBenchArgs*)0)->field) \
+}
+
+static const tBenchOpt s_pOpts[] = {
+	BENCH_OPT('n', "count", "frames in each direction (default: 1000)", sConfig.ulFrames),
+	BENCH_OPT('l', "size", "Ethernet frame size (default: 1514)", sConfig.uwFrameSize),
+	BENCH_OPT('b', "0|1", "use burst commands (default: 1)", ubBurst),
+	BENCH_OPT('r', "cycles", "Amiga reaction time (default: 40)", sTiming.uwReact),
+	BENCH_OPT('p', "cycles", "Amiga burst step (default: 100)", sTiming.uwBurstStep),
+	BENCH_OPT('g', "cycles", "gap between wire frames (default: 10Mbit pace)", sConfig.ulWireGap),
+	BENCH_OPT('t', "ms", "virtual time limit (default: 10000)", sConfig.ulTimeLimitMs),
+	BENCH_OPT('x', "flags", "protocol flags offered when going online (default: 0)", sConfig.uwProtoFlags),
+	BENCH_OPT('m', "count", "unwanted bcast/mcast frame after every count rx ones (default: 0)", sConfig.uwNoiseEvery),
+	BENCH_OPT('f', "0|1", "load ENC28J60 filter from Amiga (default: 0)", sConfig.ubFilter),
+	BENCH_OPT('c', "count", "frame with broken UDP checksum after every count rx ones (default: 0)", sConfig.uwBadCsumEvery),
+	BENCH_OPT('e', "count", "every count-th transmission ends with late collision (default: 0)", sConfig.uwTxFaultEvery),
+	BENCH_OPT('j', "count", "count-th transmission hangs until tx reset (default: 0)", sConfig.uwTxStuckNth),
+	BENCH_OPT('w', "times", "transmissions take times longer than at 10Mbit (default: 1)", sConfig.ubTxSlowdown),
+	BENCH_OPT('k', "count", "every count-th stored rx frame gets broken header (default: 0)", sConfig.uwRxFaultEvery),
+	BENCH_OPT('a', "slots", "ENC28J60 tx slots stored in config (default: firmware's)", sConfig.ubTxSlots),
+	BENCH_OPT('u', "ms", "link goes down for 30ms every ms (default: 0)", sConfig.uwLinkFlapMs),
+	BENCH_OPT('q', "count", "arp request for amiga's ip after every count rx ones (default: 0)", sConfig.uwArpEvery),
+	BENCH_OPT('i', "count", "ping of amiga's ip after every count rx ones (default: 0)", sConfig.uwEchoEvery),
+};
+
+#define BENCH_OPT_COUNT (sizeof(s_pOpts) / sizeof(s_pOpts[0]))
+
+static void printUsage(const char *szName) {
+	printf(
+		"Usage: %s [options]\n"
+		"  -s rx|tx|mix  scenario (default: rx)\n",
+		szName
+	);
+	for(uint8_t i = 0; i < BENCH_OPT_COUNT; ++i) {
+		printf(
+			"  -%c %-10s %s\n",
+			s_pOpts[i].cName, s_pOpts[i].szArg, s_pOpts[i].szHelp
+		);
+	}
+}
+
+/**
+ * Stores value of numeric option.
+ * @return 0 if there's no such option, otherwise 1.
+ */
+static uint8_t parseOpt(tBenchArgs *pArgs, char cName, unsigned long ulVal) {
+	for(uint8_t i = 0; i < BENCH_OPT_COUNT; ++i) {
+		const tBenchOpt *pOpt = &s_pOpts[i];
+		if(pOpt->cName != cName)
+			continue;
+		uint8_t *pField = (uint8_t*)pArgs + pOpt->ulOffs;
+		if(pOpt->ubSize == sizeof(uint8_t))
+			*pField = ulVal;
+		else if(pOpt->ubSize == sizeof(uint16_t))
+			*(uint16_t*)pField = ulVal;
+		else
+			*(uint32_t*)pField = ulVal;
+		return 1;
+	}
+	return 0;
+}
+
+static double cyclesToSec(uint64_t ullCycles) {
+	return (double)ullCycles / F_CPU;
+}
+
+static void printReport(const tBenchConfig *pConfig, uint8_t ubBurst) {
+	const tBenchStats *pStats = &g_sBenchStats;
+	uint64_t ullSpan = pStats->ullEndCycles - pStats->ullStartCycles;
+	double fSec = cyclesToSec(ullSpan);
+	uint32_t ulFrames = pStats->ulRxOk + pStats->ulTxOk;
+
+	printf(
+		"scenario: %s%s, %u frames of %u bytes, burst %s\n",
+		(pConfig->ubScenario & BENCH_RX) ? "rx" : "",
+		(pConfig->ubScenario & BENCH_TX) ? "tx" : "",
+		pConfig->ulFrames, pConfig->uwFrameSize, ubBurst ? "on" : "off"
+	);
+	printf(
+		"virtual time: %.3f ms%s\n", fSec * 1000,
+		pStats->ubTimedOut ? " (time limit reached)" : ""
+	);
+	if(pConfig->ubScenario & BENCH_RX) {
+		printf(
+			"rx: injected %u, ok %u, bad %u, enc overflow %u, filtered %u\n",
+			pStats->ulRxInjected, pStats->ulRxOk, pStats->ulRxBad,
+			g_sEncsimStats.ulRxOverflows, g_sEncsimStats.ulRxFiltered
+		);
+		printf(
+			"rx drops: pio %u (overflows %u, resets %u), pb %u; enc missed %u\n",
+			stats[STATS_ID_PIO_RX].drop, stats_rx_buf.overflows,
+			stats_rx_buf.resets, stats[STATS_ID_PB_RX].drop,
+			g_sEncsimStats.ulRxMissed
+		);
+		if(pStats->ulNoiseInjected) {
+			printf(
+				"rx noise: injected %u, reached amiga %u, saved by enc filter %u\n",
+				pStats->ulNoiseInjected, pStats->ulNoiseRx,
+				g_sEncsimStats.ulRxFiltered
+			);
+		}
+		if(pStats->ulBadCsumInjected) {
+			printf(
+				"rx bad csum: injected %u, reached amiga %u, dropped by avr %u\n",
+				pStats->ulBadCsumInjected, pStats->ulBadCsumRx,
+				stats[STATS_ID_PIO_RX].drop - stats_rx_buf.overflows
+			);
+		}
+	}
+	if(pConfig->ubScenario & BENCH_TX) {
+		printf(
+			"tx: queued %u, ok %u, bad %u, aborted %u (avr saw %u, late col %u)\n",
+			pConfig->ulFrames, pStats->ulTxOk, pStats->ulTxBad,
+			g_sEncsimStats.ulTxAborted, stats[STATS_ID_PIO_TX].err,
+			stats_tx_queue.late_cols
+		);
+	}
+	if(pConfig->uwLinkFlapMs) {
+		printf(
+			"link: flaps %u, seen by avr %u, amiga events %u; tx lost: %u on wire, "
+			"%u flushed, %u not queued\n",
+			pStats->ulLinkFlaps, stats_link.downs, pStats->ulLinkEvents,
+			g_sEncsimStats.ulTxNoLink, stats[STATS_ID_PIO_TX].drop,
+			stats[STATS_ID_PB_TX].drop
+		);
+	}
+	if(pStats->ulArpInjected) {
+		printf(
+			"arp: injected %u, reached amiga %u, answered by avr %u, replies on wire %u\n",
+			pStats->ulArpInjected, pStats->ulArpRx, stats_offload.arp_replies,
+			pStats->ulArpReplies
+		);
+	}
+	if(pConfig->uwProtoFlags & PBPROTO_FLAG_IP_ONLY) {
+		printf(
+			"ip-only: arp requests by avr %u, seen on wire %u; rx drops %u\n",
+			stats_offload.arp_requests, pStats->ulNeighRequests,
+			stats[STATS_ID_PB_RX].drop
+		);
+	}
+	if(pConfig->uwProtoFlags & PBPROTO_FLAG_HDR_COMPRESS) {
+		printf(
+			"hdrc: compressed to amiga %u (avr %u), from amiga %u\n",
+			pStats->ulHdrcRx, stats_offload.hdrc_rx, stats_offload.hdrc_tx
+		);
+	}
+	if(pStats->ulEchoInjected) {
+		printf(
+			"icmp: injected %u, reached amiga %u, answered by avr %u, replies on wire %u\n",
+			pStats->ulEchoInjected, pStats->ulEchoRx, stats_offload.echo_replies,
+			pStats->ulEchoReplies
+		);
+	}
+	printf(
+		"amiga: sent %u, received %u (magic %u), timeouts %u\n",
+		g_sAmigaStats.ulTxFrames, g_sAmigaStats.ulRxFrames,
+		g_sAmigaStats.ulRxMagic, g_sAmigaStats.ulTimeouts
+	);
+	if(fSec > 0) {
+		printf(
+			"throughput: %.1f packets/s, %.0f bytes/s\n",
+			ulFrames / fSec, pStats->ullPayloadBytes / fSec
+		);
+	}
+	printf(
+		"spi: %llu bytes, %u selects; isr: %u calls; irq-off max: %u cycles\n",
+		(unsigned long long)g_sHalStats.ullSpiBytes, g_sHalStats.ulSpiSelects,
+		g_sHalStats.ulIsrCount, g_sHalStats.ulIrqOffMax
+	);
+	printf(
+		"enc: rx stored %u, pending %u, ring peak %u bytes, dma runs %u\n",
+		g_sEncsimStats.ulRxFrames, encsimGetPktCnt(), g_sEncsimStats.uwRxPeak,
+		g_sEncsimStats.ulDmaRuns
+	);
+	printf(
+		"tx queue: max depth %u, stalls %u, stuck drops %u; "
+		"rx buffer peak: %u frames, %u bytes\n",
+		stats_tx_queue.max_depth, stats_tx_queue.stalls, stats_tx_queue.drops,
+		stats_rx_buf.peak_frames, stats_rx_buf.peak_fill
+	);
+	printf(
+		"enc spi of last frame: rx %u bytes, %u selects; tx %u bytes, %u selects\n",
+		stats_spi.rx_bytes, stats_spi.rx_selects,
+		stats_spi.tx_bytes, stats_spi.tx_selects
+	);
+
+	printf("%-11s %10s %14s %12s %12s\n",
+		"stage", "calls", "cycles", "cycles/call", "cycles/byte"
+	);
+	for(uint8_t i = 0; i < BENCH_STAGE_COUNT; ++i) {
+		const tBenchStage *pStage = &pStats->pStages[i];
+		printf("%-11s %10u %14llu", s_pStageNames[i], pStage->ulCalls,
+			(unsigned long long)pStage->ullCycles
+		);
+		if(pStage->ulCalls)
+			printf(" %12.1f", (double)pStage->ullCycles / pStage->ulCalls);
+		else
+			printf(" %12s", "-");
+		if(pStage->ullBytes)
+			printf(" %12.2f", (double)pStage->ullCycles / pStage->ullBytes);
+		else
+			printf(" %12s", "-");
+		printf("\n");
+	}
+}
+
+int main(int lArgCount, char *pArgs[]) {
+	tBenchArgs sArgs = {
+		.sConfig = {
+			.ubScenario = BENCH_RX, .ulFrames = 1000, .uwFrameSize = 1514,
+			.ulWireGap = 0, .ulTimeLimitMs = 10000, .uwProtoFlags = 0
+		},
+		.sTiming = {.uwReact = 40, .uwBurstStep = 100},
+		.ubBurst = 1
+	};
+	tBenchConfig *pConfig = &sArgs.sConfig;
+
+	for(int i = 1; i < lArgCount; ++i) {
+		const char *szOpt = pArgs[i];
+		if(szOpt[0] != '-' || !szOpt[1] || szOpt[2] || i + 1 >= lArgCount) {
+			printUsage(pArgs[0]);
+			return EXIT_FAILURE;
+		}
+		const char *szVal = pArgs[++i];
+		if(szOpt[1] == 's') {
+			if(!strcmp(szVal, "rx"))
+				pConfig->ubScenario = BENCH_RX;
+			else if(!strcmp(szVal, "tx"))
+				pConfig->ubScenario = BENCH_TX;
+			else if(!strcmp(szVal, "mix"))
+				pConfig->ubScenario = BENCH_RX | BENCH_TX;
+			else {
+				printUsage(pArgs[0]);
+				return EXIT_FAILURE;
+			}
+		}
+		else if(!parseOpt(&sArgs, szOpt[1], strtoul(szVal, 0, 0))) {
+			printUsage(pArgs[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	halInit();
+	encsimInit();
+	amigaInit(&sArgs.sTiming, sArgs.ubBurst);
+	benchInit(pConfig);
+
+	if(!setjmp(g_sHalExit))
+		firmwareMain();
+
+	printReport(pConfig, sArgs.ubBurst);
+	// Every aborted transmission must be seen and retired by AVR
+	uint8_t isTxLost = stats_tx_queue.late_cols != g_sEncsimStats.ulTxAborted;
+	return (
+		g_sBenchStats.ubTimedOut || g_sBenchStats.ulRxBad ||
+		g_sBenchStats.ulTxBad || isTxLost
+	) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
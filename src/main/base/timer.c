@@ -9,6 +9,7 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/cpufunc.h>
 #include <main/spi/enc28j60.h>
 #include <main/pinout.h>
 
@@ -66,13 +67,16 @@ ISR(TIMER1_COMPA_vect) {
 /// Busy-wait for supplied number of 10ms intervals
 void timerDelay10ms(uint16_t uwCount) {
 	g_uwTimer10ms=0;
-	while(g_uwTimer10ms<uwCount);
+	// NOTE: _NOP() lets host build advance its virtual clock
+	while(g_uwTimer10ms<uwCount)
+		_NOP();
 }
 
 /// Busy-wait for supplied number of 100us intervals
 void timerDelay100us(uint16_t uwCount) {
 	g_uwTimer100us=0;
-	while(g_uwTimer100us<uwCount);
+	while(g_uwTimer100us<uwCount)
+		_NOP();
 }
 
 // TODO(KaiN#9): timerCalculateKbps() is completely messed up
@@ -7,6 +7,7 @@
 
 #include <main/global.h>
 
+#include <string.h>
 #include <main/pkt_buf.h>
 #include <main/pb_proto.h>
 #include <main/base/uartutil.h>
@@ -19,6 +20,10 @@
 #include <main/pio.h>
 #include <main/net/eth.h>
 #include <main/net/net.h>
+#include <main/net/arp.h>
+#include <main/net/ip.h>
+#include <main/net/neigh.h>
+#include <main/net/hdrc.h>
 #include <main/spi/enc28j60.h>
 #include <main/cmd.h>
 #include <main/pinout.h>
@@ -31,9 +36,17 @@
 #define FLAG_FIRST_TRANSFER    4
 // Set if there is cmd response pending for Amiga
 #define FLAG_SEND_CMD_RESPONSE 8
+// Set if Amiga offered protocol flags in its online magic packet
+#define FLAG_NEGOTIATED        16
+// Set if there is need to send link magic packet to Amiga
+#define FLAG_SEND_LINK         32
+// Set if Amiga's IP address is known, see bridgeLearnIp()
+#define FLAG_AMIGA_IP          64
 
 uint8_t s_ubFlags;
 static uint8_t req_is_pending;
+static uint8_t s_pAmigaIp[4];
+static uint8_t s_ubRxPeeked; // next frame in ENC28J60 is to be left for Amiga
 
 static void bridgeRequestResponseRead(void)
 {
@@ -48,12 +61,57 @@ static void bridgeRequestResponseRead(void)
 /**
  * Enables ethernet communication, also sets MAC address to value specified
  * in eth frame.
+ * If Amiga offered protocol flags, supported ones are accepted and sent back
+ * in online magic packet. Older drivers send bare header and get no response.
+ * With PBPROTO_FLAG_CSUM_OFFLOAD accepted, Amiga may leave IP/TCP/UDP
+ * checksums of sent frames unfilled and needn't verify received ones.
+ * With PBPROTO_FLAG_ARP_OFFLOAD or PBPROTO_FLAG_ICMP_OFFLOAD accepted, ARP
+ * requests or pings for Amiga's IP are answered by plipUltimate and never
+ * reach Amiga.
+ * With PBPROTO_FLAG_IP_ONLY accepted, IPv4 packets cross parallel port without
+ * Ethernet header, see bridgeProcessPacket(). Other frames from the wire
+ * don't reach Amiga at all.
+ * With PBPROTO_FLAG_HDR_COMPRESS accepted, frames exchanged with peers which
+ * Amiga installed contexts for carry tag instead of header, see net/hdrc.h.
+ * It's refused along with PBPROTO_FLAG_IP_ONLY, which strips headers anyway.
  * @param buf Pointer to magic packet.
+ * @param size Magic packet length.
  */
-static void bridgeCommOnline(const uint8_t *buf)
+static void bridgeCommOnline(const uint8_t *buf, uint16_t size)
 {
 	// NOTE: UART - time_stamp_spc() [MAGIC] online \r\n
   s_ubFlags |= FLAG_ONLINE | FLAG_FIRST_TRANSFER;
+  // Stack may have been reconfigured, IP is learned anew
+  s_ubFlags &= ~FLAG_AMIGA_IP;
+
+  // Response is even-sized, so it's sent the same way with any flags
+  if(size >= ETH_OFF_MAGIC_FLAGS + 2) {
+    pb_proto_flags = net_get_word(buf + ETH_OFF_MAGIC_FLAGS) & PBPROTO_FLAGS_SUPPORTED;
+    if(pb_proto_flags & PBPROTO_FLAG_IP_ONLY)
+      pb_proto_flags &= ~PBPROTO_FLAG_HDR_COMPRESS;
+    s_ubFlags |= FLAG_NEGOTIATED | FLAG_SEND_MAGIC;
+    bridgeRequestResponseRead();
+  }
+  else {
+    pb_proto_flags = 0;
+    s_ubFlags &= ~FLAG_NEGOTIATED;
+  }
+  enc28j60_set_csum_offload((pb_proto_flags & PBPROTO_FLAG_CSUM_OFFLOAD) != 0);
+  // Amiga's frames are put after room for Ethernet header, filled in by AVR
+  if(pb_proto_flags & PBPROTO_FLAG_IP_ONLY)
+    pb_proto_headroom = ETH_HDR_SIZE;
+  else if(pb_proto_flags & PBPROTO_FLAG_HDR_COMPRESS)
+    pb_proto_headroom = HDRC_ROOM;
+  else
+    pb_proto_headroom = 0;
+  neigh_reset();
+  hdrc_reset();
+  // Amiga's stack may have come up while link was down
+  if(pb_proto_flags & PBPROTO_FLAG_LINK_EVENTS)
+    s_ubFlags |= FLAG_SEND_LINK;
+
+  // Magic packet came with send_burst - tune recv_burst to Amiga's pace
+  parCalibrateBurst();
 
   // validate mac address and if it does not match then reconfigure PIO
   const uint8_t *src_mac = eth_get_src_mac(buf);
@@ -64,7 +122,7 @@ static void bridgeCommOnline(const uint8_t *buf)
 
     // re-configure PIO
     enc28j60_exit();
-    enc28j60_init(g_sConfig.mac_addr, PIO_INIT_BROAD_CAST);
+    enc28j60_init(g_sConfig.mac_addr, PIO_INIT_BROAD_CAST, g_sConfig.tx_slots);
   }
 }
 
@@ -74,7 +132,14 @@ static void bridgeCommOnline(const uint8_t *buf)
 static void bridgeCommOffline(void)
 {
 	// NOTE: UART - time_stamp_spc() [MAGIC] offline
-  s_ubFlags &= ~FLAG_ONLINE;
+  s_ubFlags &= ~(
+    FLAG_ONLINE | FLAG_NEGOTIATED | FLAG_SEND_LINK | FLAG_AMIGA_IP
+  );
+  pb_proto_flags = 0;
+  pb_proto_headroom = 0;
+  // Filter and offload were set up by Amiga's stack which is now gone
+  enc28j60_set_filter(0);
+  enc28j60_set_csum_offload(0);
 }
 
 static void bridgeLoopback(uint16_t size)
@@ -83,6 +148,15 @@ static void bridgeLoopback(uint16_t size)
   bridgeRequestResponseRead();
 }
 
+/**
+ * Lets Amiga know about link change, if it has asked for that.
+ */
+static void bridgeLinkChanged(void)
+{
+  if((s_ubFlags & FLAG_ONLINE) && (pb_proto_flags & PBPROTO_FLAG_LINK_EVENTS))
+    s_ubFlags |= FLAG_SEND_LINK;
+}
+
 static void request_magic(void)
 {
 	// NOTE: UART - time_stamp_spc() [MAGIC] request\r\n
@@ -92,11 +166,377 @@ static void request_magic(void)
   bridgeRequestResponseRead();
 }
 
+// ----- offload -----
+
+/**
+ * Remembers Amiga's IP address, taken from source of its IPv4 and ARP frames.
+ * Stack which isn't configured yet (e.g. doing DHCP) sends 0.0.0.0 - that one
+ * isn't learned.
+ * @param uwSize Size of Amiga's frame in g_pDataBuffer.
+ */
+static void bridgeLearnIp(uint16_t uwSize)
+{
+  const uint8_t *ip;
+  const uint8_t *pkt = g_pDataBuffer + ETH_HDR_SIZE;
+  if(eth_is_ipv4_pkt(g_pDataBuffer)) {
+    if(uwSize < ETH_HDR_SIZE + IP_MIN_HDR_SIZE)
+      return;
+    ip = ip_get_src_ip(pkt);
+  }
+  else if(eth_is_arp_pkt(g_pDataBuffer)) {
+    if(uwSize < ETH_HDR_SIZE + ARP_SIZE || !arp_is_ipv4(pkt, ARP_SIZE))
+      return;
+    ip = arp_get_src_ip(pkt);
+  }
+  else
+    return;
+
+  if(!net_compare_ip(ip, net_zero_ip)) {
+    net_copy_ip(ip, s_pAmigaIp);
+    s_ubFlags |= FLAG_AMIGA_IP;
+  }
+}
+
+/**
+ * Answers ARP request for Amiga's IP.
+ * @param frame Frame peeked from ENC28J60, at least ETH_HDR_SIZE + ARP_SIZE
+ *        bytes long. Reply is built in it.
+ * @return 1 if frame got answered and dropped, otherwise 0.
+ */
+static uint8_t bridgeAnswerArp(uint8_t *frame)
+{
+  uint8_t *arp = frame + ETH_HDR_SIZE;
+  if(
+    !eth_is_arp_pkt(frame) || !arp_is_ipv4(arp, ARP_SIZE) ||
+    arp_get_op(arp) != ARP_REQUEST ||
+    !net_compare_ip(arp_get_tgt_ip(arp), s_pAmigaIp)
+  ) {
+    return 0;
+  }
+  enc28j60_drop();
+
+  // Reply goes straight back to asking host
+  net_copy_mac(arp_get_src_mac(arp), frame + ETH_OFF_TGT_MAC);
+  net_copy_mac(g_sConfig.mac_addr, frame + ETH_OFF_SRC_MAC);
+  arp_make_reply(arp, g_sConfig.mac_addr, s_pAmigaIp);
+  if(enc28j60_send(frame, ETH_HDR_SIZE + ARP_SIZE) == PIO_OK)
+    ++stats_offload.arp_replies;
+  return 1;
+}
+
+/**
+ * Answers ICMP echo request for Amiga's IP.
+ * Reply is request rewritten in place: addresses get swapped and ICMP type
+ * changed. Only those headers go over SPI - ENC28J60 copies payload into TX
+ * buffer and sums it up on its own, so pings of any size are cheap.
+ * IP header checksum stays valid since addresses only change places.
+ * @param frame Frame peeked from ENC28J60, at least ETH_HDR_SIZE +
+ *        IP_MIN_HDR_SIZE + ICMP_HDR_SIZE bytes long. Gets rewritten.
+ * @param size Whole frame size.
+ * @return 1 if frame got answered and dropped, otherwise 0.
+ */
+static uint8_t bridgeAnswerEcho(uint8_t *frame, uint16_t size)
+{
+  uint8_t *ip = frame + ETH_HDR_SIZE;
+  uint8_t *icmp = ip + IP_MIN_HDR_SIZE;
+  uint16_t len = ip_get_total_length(ip);
+  // Options and fragments are rare enough to be left to Amiga
+  if(
+    !eth_is_ipv4_pkt(frame) || ip_get_hdr_length(ip) != IP_MIN_HDR_SIZE ||
+    ip_is_fragment(ip) || ip_get_protocol(ip) != IP_PROTOCOL_ICMP ||
+    !net_compare_ip(ip_get_tgt_ip(ip), s_pAmigaIp) ||
+    len < IP_MIN_HDR_SIZE + ICMP_HDR_SIZE || len > size - ETH_HDR_SIZE ||
+    icmp[0] != ICMP_TYPE_ECHO_REQUEST || icmp[1]
+  ) {
+    return 0;
+  }
+
+  net_copy_mac(eth_get_src_mac(frame), frame + ETH_OFF_TGT_MAC);
+  net_copy_mac(g_sConfig.mac_addr, frame + ETH_OFF_SRC_MAC);
+  net_copy_ip(ip_get_src_ip(ip), ip + IP_TGT_IP_OFF);
+  net_copy_ip(s_pAmigaIp, ip + IP_SRC_IP_OFF);
+  icmp[0] = ICMP_TYPE_ECHO_REPLY;
+  net_put_word(icmp + ICMP_CHECKSUM_OFF, 0);
+
+  // Ethernet padding is left out of reply
+  uint8_t icmp_offs = ETH_HDR_SIZE + IP_MIN_HDR_SIZE;
+  if(enc28j60_bounce(
+    frame, icmp_offs + ICMP_CHECKSUM_OFF + 2, ETH_HDR_SIZE + len,
+    icmp_offs, icmp_offs + ICMP_CHECKSUM_OFF
+  ) != PIO_OK) {
+    return 0;
+  }
+  ++stats_offload.echo_replies;
+  return 1;
+}
+
+// ----- IP-only mode -----
+
+/**
+ * Fills neighbour cache with sender of frame peeked from ENC28J60.
+ * @param frame Frame's first bytes.
+ * @param size Whole frame size.
+ */
+static void bridgeLearnNeigh(const uint8_t *frame, uint16_t size)
+{
+  const uint8_t *pkt = frame + ETH_HDR_SIZE;
+  if(eth_is_arp_pkt(frame)) {
+    if(size >= ETH_HDR_SIZE + ARP_SIZE && arp_is_ipv4(pkt, ARP_SIZE))
+      neigh_learn(arp_get_src_ip(pkt), arp_get_src_mac(pkt));
+  }
+  else if(eth_is_ipv4_pkt(frame) && size >= ETH_HDR_SIZE + IP_MIN_HDR_SIZE)
+    neigh_learn(ip_get_src_ip(pkt), eth_get_src_mac(frame));
+}
+
+/**
+ * Makes ENC28J60 hand out just IPv4 packet of next frame, without Ethernet
+ * header and padding.
+ * @param frame Frame's first bytes.
+ * @param size Whole frame size.
+ * @return 1 if frame may go to Amiga, 0 if it's not an IPv4 one.
+ */
+static uint8_t bridgeStripFrame(const uint8_t *frame, uint16_t size)
+{
+  const uint8_t *ip = frame + ETH_HDR_SIZE;
+  if(
+    !eth_is_ipv4_pkt(frame) || size < ETH_HDR_SIZE + IP_MIN_HDR_SIZE ||
+    ip_get_version(ip) != 4
+  ) {
+    return 0;
+  }
+  uint16_t len = ip_get_total_length(ip);
+  if(len < IP_MIN_HDR_SIZE || len > size - ETH_HDR_SIZE)
+    return 0;
+  enc28j60_set_rx_window(ETH_HDR_SIZE, len);
+  return 1;
+}
+
+/**
+ * Asks local network for MAC of next hop of Amiga's packet.
+ * Packet itself is dropped - there's no room to keep it until reply comes,
+ * so it's up to Amiga's stack to send it again. Request is built in its place.
+ * @param hop Address to be resolved, not within g_pDataBuffer.
+ */
+static void bridgeRequestNeigh(const uint8_t *hop)
+{
+  uint8_t *frame = g_pDataBuffer;
+  eth_make_bcast(frame, g_sConfig.mac_addr);
+  eth_set_pkt_type(frame, ETH_TYPE_ARP);
+  arp_make_request(
+    frame + ETH_HDR_SIZE, g_sConfig.mac_addr,
+    (s_ubFlags & FLAG_AMIGA_IP) ? s_pAmigaIp : net_zero_ip, hop
+  );
+  if(enc28j60_send(frame, ETH_HDR_SIZE + ARP_SIZE) == PIO_OK)
+    ++stats_offload.arp_requests;
+}
+
+/**
+ * Fills Ethernet header of IPv4 packet sent by Amiga in IP-only mode.
+ * EtherType is already there, header room was left by pb_proto.
+ * @param uwSize Frame size, including header.
+ * @return 1 on success, 0 if frame has to be dropped.
+ */
+static uint8_t bridgeAddEthHdr(uint16_t uwSize)
+{
+  uint8_t hop[4];
+  const uint8_t *ip = g_pDataBuffer + ETH_HDR_SIZE;
+  if(uwSize < ETH_HDR_SIZE + IP_MIN_HDR_SIZE)
+    return 0;
+  if(!neigh_resolve(ip_get_tgt_ip(ip), g_pDataBuffer + ETH_OFF_TGT_MAC, hop)) {
+    bridgeRequestNeigh(hop);
+    return 0;
+  }
+  net_copy_mac(g_sConfig.mac_addr, g_pDataBuffer + ETH_OFF_SRC_MAC);
+  return 1;
+}
+
+// ----- padding -----
+
+// Peeked bytes telling length of IPv4 and ARP packets
+#define BRIDGE_PEEK_LENGTH (ETH_HDR_SIZE + ARP_OFF_OP)
+
+/**
+ * Finds real length of frame from the wire, which is less than its size if
+ * sender padded it to Ethernet minimum. Only IPv4 and ARP frames are looked
+ * at - they are most of short ones and tell their length on their own.
+ * @param frame Frame's first BRIDGE_PEEK_LENGTH bytes.
+ * @param size Whole frame size.
+ * @return Frame length without padding, size if it isn't known.
+ */
+static uint16_t bridgeFrameLength(const uint8_t *frame, uint16_t size)
+{
+  const uint8_t *pkt = frame + ETH_HDR_SIZE;
+  uint16_t len;
+  if(size < BRIDGE_PEEK_LENGTH)
+    return size;
+  if(eth_is_ipv4_pkt(frame)) {
+    len = ip_get_total_length(pkt);
+    if(len < IP_MIN_HDR_SIZE)
+      return size;
+  }
+  else if(eth_is_arp_pkt(frame))
+    len = ARP_OFF_SRC_MAC + 2 * (pkt[ARP_OFF_HW_SIZE] + pkt[ARP_OFF_PROT_SIZE]);
+  else
+    return size;
+  // Broken length is left for Amiga's stack to deal with
+  return (len < size - ETH_HDR_SIZE) ? ETH_HDR_SIZE + len : size;
+}
+
+// ----- header compression -----
+
+/**
+ * Makes ENC28J60 hand out next frame with its header replaced by tag of
+ * matching context. Frame without one goes as it is, unless its first byte
+ * would be taken for tag.
+ * @param frame Frame's first bytes.
+ * @param len Frame length, padding may already be cut off.
+ */
+static void bridgeCompressFrame(const uint8_t *frame, uint16_t len)
+{
+  uint8_t tag = 0;
+  if(len > ETH_HDR_SIZE)
+    tag = hdrc_find(frame, g_sConfig.mac_addr);
+  if(tag) {
+    enc28j60_set_rx_window(ETH_HDR_SIZE, len - ETH_HDR_SIZE);
+    enc28j60_set_rx_lead(tag);
+    ++stats_offload.hdrc_rx;
+  }
+  else if(len && hdrc_is_tag(frame[0])) {
+    enc28j60_set_rx_window(0, len);
+    enc28j60_set_rx_lead(HDRC_TAG_RAW);
+  }
+}
+
+/**
+ * Brings frame sent by Amiga in compressed framing to its usual form.
+ * Frame was put after HDRC_ROOM bytes, so compressed one just gets header
+ * in place of its tag, others are moved to buffer's start.
+ * @param pSize Frame size, updated.
+ * @param pStreamed Cleared if streamed copy of frame is no good any more.
+ * @return 1 on success, 0 if frame has to be dropped.
+ */
+static uint8_t bridgeExpandFrame(uint16_t *pSize, uint8_t *pStreamed)
+{
+  uint8_t tag = g_pDataBuffer[HDRC_ROOM];
+  uint8_t skip = HDRC_ROOM;
+  if(*pSize && tag != HDRC_TAG_RAW && hdrc_is_tag(tag)) {
+    if(!hdrc_expand(tag, g_pDataBuffer, g_sConfig.mac_addr))
+      return 0;
+    *pSize += HDRC_ROOM;
+    ++stats_offload.hdrc_tx;
+    return 1;
+  }
+  if(*pSize && tag == HDRC_TAG_RAW) {
+    ++skip;
+    --*pSize;
+  }
+  memmove(g_pDataBuffer, g_pDataBuffer + skip, *pSize);
+  // Streamed copy is off by header room
+  *pStreamed = 0;
+  return 1;
+}
+
+// ----- rx classification -----
+
+// Peeked bytes telling what to do with frame
+#define BRIDGE_PEEK_SIZE (ETH_HDR_SIZE + ARP_SIZE)
+// Frames are peeked into g_pDataBuffer's end, which is free meanwhile - cmd
+// response waiting to be read is kept at its start
+#define BRIDGE_PEEK_BUF (g_pDataBuffer + DATABUF_SIZE - BRIDGE_PEEK_SIZE)
+
+/**
+ * Takes care of next frame in ENC28J60 if Amiga needn't see it: answers
+ * requests for Amiga's IP which AVR was allowed to take care of and, in
+ * IP-only mode, drops non-IPv4 frames or strips IPv4 ones to bare packets.
+ * With header compression, frame's header is replaced by tag if it can be.
+ * With exact transfers, Ethernet padding is cut off from IPv4 and ARP frames.
+ * Only headers are peeked, so other frames cost just a few SPI bytes before
+ * they go to Amiga as usual. Each frame is peeked once.
+ * @return 1 if frame got answered or dropped, otherwise 0.
+ */
+static uint8_t bridgeOffloadFrame(void)
+{
+  uint8_t *frame = BRIDGE_PEEK_BUF;
+  uint16_t size;
+  uint8_t ubIpOnly = (pb_proto_flags & PBPROTO_FLAG_IP_ONLY) != 0;
+  uint8_t ubTrim = (pb_proto_flags & PBPROTO_FLAG_EXACT_SIZE) != 0;
+  // Less is enough to pick compression context and to find padding
+  uint8_t peek = BRIDGE_PEEK_SIZE;
+  if(!ubIpOnly && !(
+    (s_ubFlags & FLAG_AMIGA_IP) &&
+    (pb_proto_flags & (PBPROTO_FLAG_ARP_OFFLOAD | PBPROTO_FLAG_ICMP_OFFLOAD))
+  )) {
+    peek = ubTrim ? BRIDGE_PEEK_LENGTH : ETH_HDR_SIZE;
+  }
+  if(s_ubRxPeeked || enc28j60_peek(0, 0, frame, peek, &size) != PIO_OK)
+    return 0;
+  if(ubIpOnly)
+    bridgeLearnNeigh(frame, size);
+  if(
+    peek == BRIDGE_PEEK_SIZE && size >= BRIDGE_PEEK_SIZE &&
+    (s_ubFlags & FLAG_AMIGA_IP)
+  ) {
+    // ARP never reaches Amiga in IP-only mode, so it's answered regardless
+    if(
+      (pb_proto_flags & (PBPROTO_FLAG_ARP_OFFLOAD | PBPROTO_FLAG_IP_ONLY)) &&
+      bridgeAnswerArp(frame)
+    ) {
+      return 1;
+    }
+    if((pb_proto_flags & PBPROTO_FLAG_ICMP_OFFLOAD) && bridgeAnswerEcho(frame, size))
+      return 1;
+  }
+  if(ubIpOnly && !bridgeStripFrame(frame, size)) {
+    if(enc28j60_drop() == PIO_OK)
+      stats_get(STATS_ID_PB_RX)->drop++;
+    return 1;
+  }
+  // IP-only window has left padding out already
+  uint16_t len = (ubTrim && !ubIpOnly) ? bridgeFrameLength(frame, size) : size;
+  if(pb_proto_flags & PBPROTO_FLAG_HDR_COMPRESS)
+    bridgeCompressFrame(frame, len);
+  else if(len != size)
+    enc28j60_set_rx_window(0, len);
+  s_ubRxPeeked = 1;
+  return 0;
+}
+
+/**
+ * Takes care of frames at front of ENC28J60 RX buffer which Amiga needn't see.
+ * @return Frames left for Amiga, as with enc28j60_has_recv(). Count is taken
+ *         anew since peeking may have found RX buffer corrupted and reset it.
+ */
+static uint8_t bridgeOffloadRx(void)
+{
+  if(
+    (pb_proto_flags & (
+      PBPROTO_FLAG_EXACT_SIZE | PBPROTO_FLAG_IP_ONLY | PBPROTO_FLAG_HDR_COMPRESS
+    )) || (
+      (s_ubFlags & FLAG_AMIGA_IP) &&
+      (pb_proto_flags & (PBPROTO_FLAG_ARP_OFFLOAD | PBPROTO_FLAG_ICMP_OFFLOAD))
+    )
+  ) {
+    while(enc28j60_has_recv() && bridgeOffloadFrame())
+      continue;
+  }
+  return enc28j60_has_recv();
+}
+
 // ----- packet callbacks -----
 
 // the Amiga requests a new packet
 
-uint8_t bridgeFillPacket(uint16_t *pFilledSize) {
+/**
+ * Prepares packet for Amiga.
+ * @param pFilledSize Packet size.
+ * @param pStream If not null, frames from ENC28J60 are left there to be
+ *        streamed by caller, which is indicated by setting *pStream to 1.
+ *        Otherwise packet is put into g_pDataBuffer.
+ * @return Always PBPROTO_STATUS_OK
+ */
+uint8_t bridgeFillPacket(uint16_t *pFilledSize, uint8_t *pStream) {
+  if(pStream)
+    *pStream = 0;
   if((s_ubFlags & FLAG_SEND_MAGIC) == FLAG_SEND_MAGIC) {
 		// Send magic packet to Amiga
     s_ubFlags &= ~FLAG_SEND_MAGIC;
@@ -108,14 +548,42 @@ uint8_t bridgeFillPacket(uint16_t *pFilledSize) {
     net_put_word(g_pDataBuffer + ETH_OFF_TYPE, ETH_TYPE_MAGIC_ONLINE);
 
     *pFilledSize = ETH_HDR_SIZE;
+    if(s_ubFlags & FLAG_NEGOTIATED) {
+      // Let Amiga know which of its protocol flags were accepted
+      net_put_word(g_pDataBuffer + ETH_OFF_MAGIC_FLAGS, pb_proto_flags);
+      *pFilledSize += 2;
+    }
   }
   else if((s_ubFlags & FLAG_SEND_CMD_RESPONSE) == FLAG_SEND_CMD_RESPONSE) {
-    // Send CMD response - it's already in buffer
+    // Send CMD response - it's already in buffer, so it goes before link
+    // magic packet which would overwrite it
+    s_ubFlags &= ~FLAG_SEND_CMD_RESPONSE;
     *pFilledSize = g_uwCmdResponseSize;
   }
+  else if(s_ubFlags & FLAG_SEND_LINK) {
+    s_ubFlags &= ~FLAG_SEND_LINK;
+    net_copy_bcast_mac(g_pDataBuffer + ETH_OFF_TGT_MAC);
+    net_copy_mac(g_sConfig.mac_addr, g_pDataBuffer + ETH_OFF_SRC_MAC);
+    net_put_word(g_pDataBuffer + ETH_OFF_TYPE, ETH_TYPE_MAGIC_LINK);
+    net_put_word(g_pDataBuffer + ETH_OFF_MAGIC_LINK, g_ubEncLinkUp);
+    *pFilledSize = ETH_HDR_SIZE + 2;
+  }
   else {
 		// Receive packet buffer with data from ENC28j60 if pending
-    pio_util_recv_packet(pFilledSize);
+    // Frame is dropped on error, also one with bad checksum
+    if(!bridgeOffloadRx()) {
+      // Frame Amiga was told about may have been answered by AVR meanwhile
+      *pFilledSize = 0;
+    }
+    else if(!pStream) {
+      if(pio_util_recv_packet(pFilledSize) != PIO_OK)
+        *pFilledSize = 0;
+    }
+    else if(pio_util_recv_stream(pFilledSize) == PIO_OK)
+      *pStream = 1;
+    else
+      *pFilledSize = 0;
+    s_ubRxPeeked = 0;
 
     if(s_ubFlags & FLAG_FIRST_TRANSFER) {
 			// report first packet transfer
@@ -129,20 +597,74 @@ uint8_t bridgeFillPacket(uint16_t *pFilledSize) {
   return PBPROTO_STATUS_OK;
 }
 
+/**
+ * Fetches next frame of PBPROTO_CMD_RECV_BATCH.
+ * Only frames already waiting in ENC28J60 are batched - pending magic packets
+ * and cmd responses end the batch and go through bridgeFillPacket().
+ * @param pFilledSize Frame size, 0 if there is nothing more to send.
+ * @param ubStream If set, frame is left in ENC28J60 to be streamed by caller,
+ *        otherwise it's put into g_pDataBuffer.
+ */
+void bridgeFillNextPacket(uint16_t *pFilledSize, uint8_t ubStream) {
+  *pFilledSize = 0;
+  if(s_ubFlags & (FLAG_SEND_MAGIC | FLAG_SEND_LINK | FLAG_SEND_CMD_RESPONSE))
+    return;
+  if(!(s_ubFlags & FLAG_ONLINE) || !bridgeOffloadRx())
+    return;
+
+  // Frame is dropped on error, there's no way to skip it in batch
+  uint8_t ubResult = ubStream ?
+    pio_util_recv_stream(pFilledSize) : pio_util_recv_packet(pFilledSize);
+  s_ubRxPeeked = 0;
+  if(ubResult != PIO_OK)
+    *pFilledSize = 0;
+}
+
 /**
  * Handles packet sent by Amiga.
  * There are basically 4 possible packet types, all defined
  * by ETH_TYPE_* defines.
  * Custom "Magic" packets are defined as topmost EtherType values.
+ * In IP-only mode packet comes after pb_proto_headroom bytes. Bare IPv4 ones
+ * are told apart from magic packets and cmds, which keep Ethernet header, by
+ * version in first byte - those start with bcast MAC or CMD_* code instead.
+ * With header compression, packet comes after HDRC_ROOM bytes instead and
+ * gets its header back, see bridgeExpandFrame().
  * @param uwSize Packet length
- * @return Always PBPROTO_STATUS_OK
+ * @param ubStreamed If set, packet was also streamed into ENC28J60 TX buffer
+ *        and only needs to be sent from there.
+ * @return PBPROTO_STATUS_PACKET_TOO_LARGE if header put by AVR made frame too
+ *         large for the wire, otherwise PBPROTO_STATUS_OK.
  */
-uint8_t bridgeProcessPacket(uint16_t uwSize) {
+uint8_t bridgeProcessPacket(uint16_t uwSize, uint8_t ubStreamed) {
+  uint8_t ubBare = 0;
+  uint8_t ubStatus = PBPROTO_STATUS_OK;
+  if(pb_proto_flags & PBPROTO_FLAG_IP_ONLY) {
+    if(uwSize && ip_get_version(g_pDataBuffer + ETH_HDR_SIZE) == 4) {
+      ubBare = 1;
+      uwSize += ETH_HDR_SIZE;
+      eth_set_pkt_type(g_pDataBuffer, ETH_TYPE_IPV4);
+    }
+    else {
+      memmove(g_pDataBuffer, g_pDataBuffer + ETH_HDR_SIZE, uwSize);
+      // Streamed copy is off by header room
+      ubStreamed = 0;
+    }
+  }
+  else if(
+    (pb_proto_flags & PBPROTO_FLAG_HDR_COMPRESS) &&
+    !bridgeExpandFrame(&uwSize, &ubStreamed)
+  ) {
+    // Amiga's context table got out of step with AVR's one
+    stats_get(STATS_ID_PB_TX)->drop++;
+    return PBPROTO_STATUS_OK;
+  }
+
   // get eth type
   uint16_t eth_type = eth_get_pkt_type(g_pDataBuffer);
   switch(eth_type) {
     case ETH_TYPE_MAGIC_ONLINE:
-      bridgeCommOnline(g_pDataBuffer);
+      bridgeCommOnline(g_pDataBuffer, uwSize);
       break;
     case ETH_TYPE_MAGIC_OFFLINE:
       bridgeCommOffline();
@@ -157,15 +679,37 @@ uint8_t bridgeProcessPacket(uint16_t uwSize) {
 			bridgeRequestResponseRead();
 			break;
     default:
-      // send packet via pio
-      pio_util_send_packet(uwSize);
+      // Amiga's IP goes into ARP requests made for its packets, if needed
+      if(pb_proto_flags & (
+        PBPROTO_FLAG_ARP_OFFLOAD | PBPROTO_FLAG_ICMP_OFFLOAD | PBPROTO_FLAG_IP_ONLY
+      )) {
+        bridgeLearnIp(uwSize);
+      }
+      // send packet via pio - there's no point in queueing it without link
+      if(!g_ubEncLinkUp && enc28j60_link_poll())
+        bridgeLinkChanged();
+      // Header put by AVR may have made frame too large for the wire
+      if(uwSize > DATABUF_SIZE) {
+        stats_get(STATS_ID_PB_TX)->drop++;
+        ubStatus = PBPROTO_STATUS_PACKET_TOO_LARGE;
+      }
+      else if(
+        !g_ubEncOnline || !g_ubEncLinkUp ||
+        (ubBare && !bridgeAddEthHdr(uwSize))
+      ) {
+        stats_get(STATS_ID_PB_TX)->drop++;
+      }
+      else if(ubStreamed)
+        pio_util_send_streamed(uwSize);
+      else
+        pio_util_send_packet(uwSize);
       // if a packet arrived and we are not online then request online state
       if((s_ubFlags & FLAG_ONLINE)==0) {
         request_magic();
       }
       break;
   }
-  return PBPROTO_STATUS_OK;
+  return ubStatus;
 }
 
 /**
@@ -178,7 +722,9 @@ void bridgeLoop(void)
   parInit();
 
   // Init ENC28j60
-  enc28j60_init(g_sConfig.mac_addr, pio_util_get_init_flags());
+  enc28j60_init(
+    g_sConfig.mac_addr, pio_util_get_init_flags(), g_sConfig.tx_slots
+  );
 
   // Reset stats
   stats_reset();
@@ -186,6 +732,7 @@ void bridgeLoop(void)
   // Reset flags & request state
   s_ubFlags = 0;
   req_is_pending = 0;
+  s_ubRxPeeked = 0;
 
   uint8_t flow_control = g_sConfig.flow_ctl;
   uint8_t limit_flow = 0;
@@ -197,6 +744,15 @@ void bridgeLoop(void)
     // Calls pb_proto_handle - this is where PAR communication is done
     pb_proto_handle();
 
+    // Kick off next queued frame if previous one has left the wire
+    enc28j60_tx_poll();
+
+    if(enc28j60_link_poll())
+      bridgeLinkChanged();
+    // Also set on going online, after online magic packet is requested
+    if(s_ubFlags & FLAG_SEND_LINK)
+      bridgeRequestResponseRead();
+
     // Handle packets coming from network
 		ubPacketCount = enc28j60_has_recv();
     if(ubPacketCount) {
@@ -207,13 +763,16 @@ void bridgeLoop(void)
 
       if(s_ubFlags & FLAG_ONLINE) {
 				// Comm online: let Amiga know about new packet
-        bridgeRequestResponseRead();
+        ubPacketCount = bridgeOffloadRx();
+        if(ubPacketCount)
+          bridgeRequestResponseRead();
       }
       else {
-				// Comm offline: read packet from ENC28j60 and drop it
-        uint16_t size;
-        pio_util_recv_packet(&size);
-        // NOTE: UART - time_stamp_spc() OFFLINE DROP: hex_word(size)\r\n
+				// Comm offline: drop packet without reading it from ENC28j60
+        if(enc28j60_drop() == PIO_OK)
+          stats_get(STATS_ID_PB_RX)->drop++;
+        s_ubRxPeeked = 0;
+        // NOTE: UART - time_stamp_spc() OFFLINE DROP\r\n
       }
     }
 
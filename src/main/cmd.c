@@ -11,9 +11,12 @@
 #include <main/pkt_buf.h>
 #include <main/base/util.h>
 #include <main/net/eth.h>
+#include <main/net/neigh.h>
+#include <main/net/hdrc.h>
 #include <main/config.h>
 #include <main/spi/enc28j60.h>
 #include <main/pio_util.h>
+#include <main/stats.h>
 
 /**
  * Config write types.
@@ -24,6 +27,20 @@
 #define WRITE_TYPE_CURRENT 1
 #define WRITE_TYPE_DEFAULT 2
 
+/**
+ * Filter load types.
+ *  FILTER_TYPE_DEFAULT - go back to unicast + broadcast filter
+ *  FILTER_TYPE_CUSTOM - use enc28j60_filter_t sent after header
+ */
+#define FILTER_TYPE_DEFAULT 0
+#define FILTER_TYPE_CUSTOM  1
+
+/**
+ * Stats read flags.
+ *  STATS_READ_RESET - reset stats after they're copied into response
+ */
+#define STATS_READ_RESET 1
+
 uint16_t g_uwCmdResponseSize;
 
 // Local fn decls
@@ -34,6 +51,10 @@ static void cmdGetLog(void);
 static void cmdGetSdInfo(void);
 static void cmdSdRead(void);
 static void cmdSdWrite(void);
+static void cmdSetFilter(uint16_t uwPacketSize);
+static void cmdGetStats(void);
+static void cmdSetRoute(uint16_t uwPacketSize);
+static void cmdSetHdrCtx(uint16_t uwPacketSize);
 
 /**
  * PlipUltimate command process function.
@@ -50,6 +71,10 @@ void cmdProcess(uint16_t uwPacketSize) {
 		case CMD_SDINFO:    cmdGetSdInfo(); return;
 		case CMD_SDREAD:    cmdSdRead();    return;
 		case CMD_SDWRITE:   cmdSdWrite();   return;
+		case CMD_SETFILTER: cmdSetFilter(uwPacketSize); return;
+		case CMD_GETSTATS:  cmdGetStats();  return;
+		case CMD_SETROUTE:  cmdSetRoute(uwPacketSize); return;
+		case CMD_SETHDRCTX: cmdSetHdrCtx(uwPacketSize); return;
 	}
 }
 
@@ -87,7 +112,105 @@ static void cmdSetConfig(void) {
 
 		// Reconfigure plip
 		enc28j60_exit();
-		enc28j60_init(g_sConfig.mac_addr, pio_util_get_init_flags());
+		enc28j60_init(
+			g_sConfig.mac_addr, pio_util_get_init_flags(), g_sConfig.tx_slots
+		);
+	}
+
+	// Prepare response
+	g_pDataBuffer[1] = ubResult;
+	g_uwCmdResponseSize = ETH_HDR_SIZE;
+}
+
+/**
+ * Loads ENC28J60 receive filter, so that frames unwanted by Amiga's stack
+ * are dropped by chip instead of crossing parallel port.
+ * Filter is dropped when Amiga goes offline.
+ * ENC28J60 doesn't count frames rejected by its filters, so there's no stats
+ * counter for them. Amiga can tell the effect by PIO_RX cnt rate before and
+ * after loading filter, against unwanted frames it still gets.
+ */
+static void cmdSetFilter(uint16_t uwPacketSize) {
+	uint8_t ubResult = 1;
+
+	if(g_pDataBuffer[1] == FILTER_TYPE_DEFAULT)
+		enc28j60_set_filter(0);
+	else if(
+		g_pDataBuffer[1] != FILTER_TYPE_CUSTOM ||
+		uwPacketSize < ETH_HDR_SIZE + sizeof(enc28j60_filter_t)
+	) {
+		ubResult |= 0b10;
+	}
+	else {
+		// Filter has byte fields only, so it's taken straight from buffer
+		enc28j60_set_filter(
+			(const enc28j60_filter_t *)&g_pDataBuffer[ETH_HDR_SIZE]
+		);
+	}
+
+	// Prepare response
+	g_pDataBuffer[1] = ubResult;
+	g_uwCmdResponseSize = ETH_HDR_SIZE;
+}
+
+/**
+ * Sends stats[], stats_tx_queue, stats_rx_buf, stats_link, stats_offload and
+ * stats_spi, in that order and in AVR's little endian layout, so that Amiga
+ * can watch drops against its traffic.
+ */
+static void cmdGetStats(void) {
+	uint8_t *pDst = &g_pDataBuffer[ETH_HDR_SIZE];
+	memcpy(pDst, stats, sizeof(stats));
+	pDst += sizeof(stats);
+	memcpy(pDst, &stats_tx_queue, sizeof(stats_tx_queue));
+	pDst += sizeof(stats_tx_queue);
+	memcpy(pDst, &stats_rx_buf, sizeof(stats_rx_buf));
+	pDst += sizeof(stats_rx_buf);
+	memcpy(pDst, &stats_link, sizeof(stats_link));
+	pDst += sizeof(stats_link);
+	memcpy(pDst, &stats_offload, sizeof(stats_offload));
+	pDst += sizeof(stats_offload);
+	memcpy(pDst, &stats_spi, sizeof(stats_spi));
+	pDst += sizeof(stats_spi);
+	g_uwCmdResponseSize = pDst - g_pDataBuffer;
+
+	if(g_pDataBuffer[1] & STATS_READ_RESET)
+		stats_reset();
+	g_pDataBuffer[1] = 1;
+}
+
+/**
+ * Takes netmask and gateway of Amiga's stack, sent after header in that
+ * order. They're needed in IP-only mode to pick MAC for Amiga's packets, and
+ * are forgotten when Amiga goes online again.
+ */
+static void cmdSetRoute(uint16_t uwPacketSize) {
+	uint8_t ubResult = 1;
+
+	if(uwPacketSize < ETH_HDR_SIZE + 8)
+		ubResult |= 0b10;
+	else
+		neigh_set_route(&g_pDataBuffer[ETH_HDR_SIZE], &g_pDataBuffer[ETH_HDR_SIZE + 4]);
+
+	// Prepare response
+	g_pDataBuffer[1] = ubResult;
+	g_uwCmdResponseSize = ETH_HDR_SIZE;
+}
+
+/**
+ * Installs header compression context: its number, peer's MAC and EtherType
+ * follow header in that order. Zero EtherType makes context unused.
+ * Contexts are forgotten when Amiga goes online again.
+ */
+static void cmdSetHdrCtx(uint16_t uwPacketSize) {
+	uint8_t ubResult = 1;
+	const uint8_t *pCtx = &g_pDataBuffer[ETH_HDR_SIZE];
+
+	if(
+		uwPacketSize < ETH_HDR_SIZE + 9 ||
+		!hdrc_set(pCtx[0], &pCtx[1], net_get_word(&pCtx[7]))
+	) {
+		ubResult |= 0b10;
 	}
 
 	// Prepare response
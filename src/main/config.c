@@ -7,6 +7,7 @@
 
 
 #include <main/config.h>
+#include <stddef.h>
 #include <string.h>
 #include <avr/eeprom.h>
 #include <avr/pgmspace.h>
@@ -14,6 +15,8 @@
 #include <main/base/uartutil.h>
 #include <main/base/uart.h>
 #include <main/net/net.h>
+#include <main/pb_proto.h>
+#include <main/spi/enc28j60.h>
 
 
 //TODO(KaiN#7): Inverse config function return value logic
@@ -36,15 +39,20 @@ static const tConfig PROGMEM sc_sDefaultConfig = {
   .test_ptype = 0xfffd,
   .test_ip = { 192,168,2,222 },
   .test_port = 6800,
-  .test_mode = 0
+  .test_mode = 0,
+  .burst_delay = PBPROTO_BURST_DELAY_MAX,
+  .tx_slots = ENC28J60_TX_SLOTS_DEFAULT
 };
 
-// build check sum for parameter block
-static uint16_t configCalcCrc16(tConfig *p) {
+// Size of config saved by firmware from before burst_delay and tx_slots
+#define CONFIG_V1_SIZE offsetof(tConfig, burst_delay)
+
+// build check sum for first size bytes of parameter block
+static uint16_t configCalcCrc16(tConfig *p, uint8_t size) {
   uint16_t crc16 = 0xffff;
   uint8_t *data = (uint8_t *)p;
   uint16_t i;
-  for(i=0;i<sizeof(tConfig);i++) {
+  for(i=0;i<size;i++) {
     crc16 = _crc16_update(crc16,*data);
     data++;
   }
@@ -60,12 +68,32 @@ uint8_t configSaveToRom(void) {
   eeprom_write_block(&g_sConfig,&s_sEepromConfig,sizeof(tConfig));
 
   // calc current parameter crc
-  uint16_t crc16 = configCalcCrc16(&g_sConfig);
+  uint16_t crc16 = configCalcCrc16(&g_sConfig, sizeof(tConfig));
   eeprom_write_word(&s_uwEepromCrc,crc16);
 
   return CONFIG_OK;
 }
 
+/**
+ * Upgrades config saved by older firmware, which lacked last two fields.
+ * Its crc word was stored either before config, so it's still where crc is
+ * read from, or right after it - where burst_delay and tx_slots are now.
+ * Without this, MAC and rest of user's settings would be lost to defaults.
+ * @param crc Crc word read from its current place.
+ * @return 1 if old config was found and upgraded, otherwise 0.
+ */
+static uint8_t configUpgradeV1(uint16_t crc) {
+  uint16_t crcV1 = configCalcCrc16(&g_sConfig, CONFIG_V1_SIZE);
+  uint16_t crcAfter = g_sConfig.burst_delay | (g_sConfig.tx_slots << 8);
+  if(crcV1 != crc && crcV1 != crcAfter)
+    return 0;
+
+  g_sConfig.burst_delay = pgm_read_byte_near(&sc_sDefaultConfig.burst_delay);
+  g_sConfig.tx_slots = pgm_read_byte_near(&sc_sDefaultConfig.tx_slots);
+  configSaveToRom();
+  return 1;
+}
+
 uint8_t configLoadFromRom(void) {
   // Check if eeprom is readable
   if(!eeprom_is_ready())
@@ -76,11 +104,20 @@ uint8_t configLoadFromRom(void) {
 
   // Read crc16
   uint16_t uwCrc = eeprom_read_word(&s_uwEepromCrc);
-  if(uwCrc != configCalcCrc16(&g_sConfig)) {
+  if(
+    uwCrc != configCalcCrc16(&g_sConfig, sizeof(tConfig)) &&
+    !configUpgradeV1(uwCrc)
+  ) {
     configReset();
     return CONFIG_EEPROM_CRC_MISMATCH;
   }
 
+  // 0 loops would run 256 times, values above max were never calibrated
+  if(g_sConfig.burst_delay < PBPROTO_BURST_DELAY_MIN)
+    g_sConfig.burst_delay = PBPROTO_BURST_DELAY_MIN;
+  else if(g_sConfig.burst_delay > PBPROTO_BURST_DELAY_MAX)
+    g_sConfig.burst_delay = PBPROTO_BURST_DELAY_MAX;
+
   return CONFIG_OK;
 }
 
@@ -31,3 +31,16 @@ void arp_make_reply(uint8_t *buf, const uint8_t *my_mac, const uint8_t *my_ip)
 	net_copy_mac(my_mac, buf + ARP_OFF_SRC_MAC);
 	net_copy_ip(my_ip, buf + ARP_OFF_SRC_IP);
 }
+
+void arp_make_request(uint8_t *buf, const uint8_t *my_mac, const uint8_t *my_ip, const uint8_t *tgt_ip)
+{
+  net_put_word(buf + ARP_OFF_HW_TYPE, 1);
+  net_put_word(buf + ARP_OFF_PROT_TYPE, 0x800);
+  buf[ARP_OFF_HW_SIZE] = 6;
+  buf[ARP_OFF_PROT_SIZE] = 4;
+  net_put_word(buf + ARP_OFF_OP, ARP_REQUEST);
+  net_copy_mac(my_mac, buf + ARP_OFF_SRC_MAC);
+  net_copy_ip(my_ip, buf + ARP_OFF_SRC_IP);
+  net_copy_zero_mac(buf + ARP_OFF_TGT_MAC);
+  net_copy_ip(tgt_ip, buf + ARP_OFF_TGT_IP);
+}
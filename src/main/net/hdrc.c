@@ -0,0 +1,85 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#include <main/net/hdrc.h>
+#include <main/net/net.h>
+
+typedef struct {
+  uint8_t mac[6];
+  uint16_t type; // 0 if context is unused
+} hdrc_ctx_t;
+
+static hdrc_ctx_t hdrc_ctx[HDRC_CTX_COUNT];
+
+/**
+ * Forgets all contexts, e.g. when Amiga's stack goes away.
+ */
+void hdrc_reset(void)
+{
+  uint8_t i;
+  for(i = 0; i < HDRC_CTX_COUNT; i++)
+    hdrc_ctx[i].type = 0;
+}
+
+/**
+ * Installs context sent by Amiga.
+ * @param ctx Context number, below HDRC_CTX_COUNT.
+ * @param mac Peer's MAC.
+ * @param type EtherType, 0 to make context unused.
+ * @return 1 on success, 0 if context number is out of range.
+ */
+uint8_t hdrc_set(uint8_t ctx, const uint8_t *mac, uint16_t type)
+{
+  if(ctx >= HDRC_CTX_COUNT)
+    return 0;
+  net_copy_mac(mac, hdrc_ctx[ctx].mac);
+  hdrc_ctx[ctx].type = type;
+  return 1;
+}
+
+/**
+ * Finds context matching header of frame received for Amiga.
+ * @param frame Frame's first ETH_HDR_SIZE bytes.
+ * @param own_mac Amiga's MAC, frame has to be sent to it.
+ * @return Tag of matching context, 0 if there's none.
+ */
+uint8_t hdrc_find(const uint8_t *frame, const uint8_t *own_mac)
+{
+  uint16_t type = eth_get_pkt_type(frame);
+  if(!type || !net_compare_mac(eth_get_tgt_mac(frame), own_mac))
+    return 0;
+  uint8_t i;
+  for(i = 0; i < HDRC_CTX_COUNT; i++) {
+    if(
+      hdrc_ctx[i].type == type &&
+      net_compare_mac(hdrc_ctx[i].mac, eth_get_src_mac(frame))
+    ) {
+      return HDRC_TAG_CTX + i;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Rebuilds header of frame compressed by Amiga.
+ * @param tag Frame's tag.
+ * @param frame Filled with header sent from Amiga's MAC to context's peer.
+ * @param own_mac Amiga's MAC.
+ * @return 1 on success, 0 if tag's context is unused or tag is HDRC_TAG_RAW.
+ */
+uint8_t hdrc_expand(uint8_t tag, uint8_t *frame, const uint8_t *own_mac)
+{
+  if(tag < HDRC_TAG_CTX || tag >= HDRC_TAG_RAW)
+    return 0;
+  hdrc_ctx_t *ctx = &hdrc_ctx[tag - HDRC_TAG_CTX];
+  if(!ctx->type)
+    return 0;
+  net_copy_mac(ctx->mac, frame + ETH_OFF_TGT_MAC);
+  net_copy_mac(own_mac, frame + ETH_OFF_SRC_MAC);
+  eth_set_pkt_type(frame, ctx->type);
+  return 1;
+}
@@ -0,0 +1,126 @@
+/*
+ * This file is part of PlipUltimate.
+ * License: GPLv2
+ * Full license: https://github.com/tehKaiN/plipUltimate/blob/master/LICENSE
+ * Authors list: https://github.com/tehKaiN/plipUltimate/blob/master/AUTHORS
+ */
+
+#include <main/net/neigh.h>
+#include <main/net/net.h>
+
+typedef struct {
+  uint8_t ip[4];
+  uint8_t mac[6];
+} neigh_entry_t;
+
+static neigh_entry_t neigh_cache[NEIGH_CACHE_SIZE];
+static uint8_t neigh_next; // entry replaced when new host is learned
+static uint8_t neigh_mask[4];
+static uint8_t neigh_gw[4];
+
+/**
+ * Forgets all hosts and route, e.g. when Amiga's stack goes away.
+ */
+void neigh_reset(void)
+{
+  uint8_t i;
+  for(i = 0; i < NEIGH_CACHE_SIZE; i++)
+    net_copy_zero_ip(neigh_cache[i].ip);
+  neigh_next = 0;
+  net_copy_zero_ip(neigh_mask);
+  net_copy_zero_ip(neigh_gw);
+}
+
+/**
+ * Sets route of Amiga's stack. Without one, every host is taken as local,
+ * which works only if router answers ARP on behalf of remote ones.
+ * @param netmask Local network's mask.
+ * @param gateway Router for other networks, 0.0.0.0 if there's none.
+ */
+void neigh_set_route(const uint8_t *netmask, const uint8_t *gateway)
+{
+  net_copy_ip(netmask, neigh_mask);
+  net_copy_ip(gateway, neigh_gw);
+}
+
+static uint8_t neigh_is_local(const uint8_t *ip)
+{
+  if(net_compare_ip(neigh_gw, net_zero_ip))
+    return 1;
+  uint8_t i;
+  for(i = 0; i < 4; i++)
+    if((ip[i] ^ neigh_gw[i]) & neigh_mask[i])
+      return 0;
+  return 1;
+}
+
+static neigh_entry_t *neigh_find(const uint8_t *ip)
+{
+  uint8_t i;
+  // Unused entries hold zero address
+  if(net_compare_ip(ip, net_zero_ip))
+    return 0;
+  for(i = 0; i < NEIGH_CACHE_SIZE; i++)
+    if(net_compare_ip(neigh_cache[i].ip, ip))
+      return &neigh_cache[i];
+  return 0;
+}
+
+/**
+ * Remembers MAC of given host. Known hosts are updated in place, new ones
+ * take place of one learned longest ago.
+ * Remote hosts are skipped - their frames come from gateway's MAC, which is
+ * learned on its own.
+ */
+void neigh_learn(const uint8_t *ip, const uint8_t *mac)
+{
+  if(net_compare_ip(ip, net_zero_ip) || (mac[0] & 1) || !neigh_is_local(ip))
+    return;
+  neigh_entry_t *entry = neigh_find(ip);
+  if(!entry) {
+    entry = &neigh_cache[neigh_next];
+    neigh_next = (neigh_next + 1) % NEIGH_CACHE_SIZE;
+    net_copy_ip(ip, entry->ip);
+  }
+  net_copy_mac(mac, entry->mac);
+}
+
+/**
+ * Finds MAC to which IPv4 packet has to be sent.
+ * Broadcasts and multicasts are mapped without looking at cache.
+ * @param tgt_ip Packet's target address.
+ * @param mac Filled with MAC on success.
+ * @param hop Filled with address which has to be resolved with ARP on failure.
+ * @return 1 on success, 0 if next hop isn't known.
+ */
+uint8_t neigh_resolve(const uint8_t *tgt_ip, uint8_t *mac, uint8_t *hop)
+{
+  uint8_t i;
+  // Limited broadcast, or directed one if route is known
+  for(i = 0; i < 4 && (tgt_ip[i] | neigh_mask[i]) == 0xFF; i++)
+    continue;
+  if(net_compare_bcast_ip(tgt_ip) || (i == 4 && neigh_is_local(tgt_ip))) {
+    net_copy_bcast_mac(mac);
+    return 1;
+  }
+
+  // Multicast groups map onto 01:00:5E plus low 23 bits of address
+  if((tgt_ip[0] & 0xF0) == 0xE0) {
+    mac[0] = 0x01;
+    mac[1] = 0x00;
+    mac[2] = 0x5E;
+    mac[3] = tgt_ip[1] & 0x7F;
+    mac[4] = tgt_ip[2];
+    mac[5] = tgt_ip[3];
+    return 1;
+  }
+
+  const uint8_t *ip = neigh_is_local(tgt_ip) ? tgt_ip : neigh_gw;
+  neigh_entry_t *entry = neigh_find(ip);
+  if(!entry) {
+    net_copy_ip(ip, hop);
+    return 0;
+  }
+  net_copy_mac(entry->mac, mac);
+  return 1;
+}
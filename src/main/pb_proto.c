@@ -17,6 +17,9 @@
 #include <main/pkt_buf.h>
 #include <main/pinout.h>
 #include <main/bridge.h>
+#include <main/config.h>
+#include <main/spi/spi.h>
+#include <main/spi/enc28j60.h>
 
 // define symbolic names for protocol
 #define SET_RAK         par_low_set_busy_hi
@@ -25,21 +28,41 @@
 #define GET_SELECT      par_low_get_select
 
 /**
- * Delay loop for recv_burst - should be at least 2us
- * Each loop takes 3 cycles, e.g. arg = 6 takes 18 cycles + overhead
+ * Delay loop for recv_burst is calibrated when Amiga goes online, see
+ * parCalibrateBurst(). It's reset to PBPROTO_BURST_DELAY_MAX, which is safe
+ * for slowest Amigas, after this many consecutive recv_burst timeouts.
  */
-#if (F_CPU == 16000000)
-	#define BURST_DELAY _delay_loop_1(6)
-#elif (F_CPU == 20000000UL)
-	#define BURST_DELAY _delay_loop_1(15)
-#else
-	#error Delay loop not defined for F_CPU
-#endif
+#define BURST_TIMEOUT_FALLBACK 2
+
+/**
+ * Longest send_burst used for calibration. TCNT1 runs freely with interrupts
+ * off and wraps every 65536 cycles, so only short transfers such as 14-byte
+ * magic packets are measured.
+ */
+#define BURST_CALIB_MAX_WORDS 64
+
+/**
+ * Shortest Amiga byte period for which recv_burst streams frames straight
+ * from ENC28J60. Each SPI byte takes 16 cycles, plus loop overhead.
+ */
+#define BURST_STREAM_MIN_CYCLES 48
 
 // recv funcs
 static uint32_t trigger_ts;
 
+// Cycles per word taken by last short send_burst, 0 if not measured yet
+static uint16_t s_uwBurstWordCycles;
+static uint8_t s_ubBurstTimeouts;
+// recv_burst delay loops - one from config until Amiga's pace is calibrated.
+// Kept apart from g_sConfig so that saved config doesn't get one Amiga's pace.
+static uint8_t s_ubBurstDelay;
+// Set if bursts may stream to/from ENC28J60. Stays cleared until Amiga's pace
+// is known to be slow enough, since missed POUT edges stall the protocol.
+static uint8_t s_ubBurstStream;
+
 uint16_t pb_proto_timeout = 5000; // = 500ms in 100us ticks
+uint16_t pb_proto_flags;
+uint8_t pb_proto_headroom;
 
 // public stat func
 pb_proto_stat_t pb_proto_stat;
@@ -66,6 +89,8 @@ void parInit(void) {
 
   // Set data DDR to input
   PAR_DATA_DDR = 0x00;
+
+  s_ubBurstDelay = g_sConfig.burst_delay;
 }
 
 uint8_t parGetStatusLines(void) {
@@ -119,6 +144,20 @@ static uint8_t parWaitForSel(uint8_t select_state, uint8_t state_flag) {
   return PBPROTO_STATUS_TIMEOUT | state_flag;
 }
 
+/**
+ * Returns largest frame Amiga may send in negotiated framing.
+ * Frames keep Ethernet size on the wire, compressed framing may put
+ * HDRC_TAG_RAW in front of full one. Bare IPv4 packets in IP-only mode are
+ * told from other frames by their contents only, so those too large to get
+ * Ethernet header are refused by bridgeProcessPacket().
+ */
+static uint16_t parMaxWriteSize(void)
+{
+  if(pb_proto_flags & PBPROTO_FLAG_HDR_COMPRESS)
+    return DATABUF_SIZE + 1;
+  return DATABUF_SIZE;
+}
+
 // ---------- Handler ----------
 
 // amiga wants to send a packet
@@ -141,21 +180,22 @@ static uint8_t parHandleAmiWrite(uint16_t *pReadSize)
   uwSize |= PAR_DATA_PIN;
   PAR_STATUS_PORT ^= PAR_BUSY;
 
-  // Check with buffer size
-  if(uwSize > DATABUF_SIZE) {
+  // Check with largest frame Amiga may send
+  if(uwSize > parMaxWriteSize()) {
     return PBPROTO_STATUS_PACKET_TOO_LARGE;
   }
 
   // Original plipbox had following loop operating on words, so size has to be
-  // rounded up
-  // TODO(KaiN#9): Make odd transfers safe?
-  uwSize = (uwSize+1)&0xFFFE;
+  // rounded up unless Amiga negotiated exact transfers
+  uint16_t uwWireSize = uwSize;
+  if(!(pb_proto_flags & PBPROTO_FLAG_EXACT_SIZE))
+    uwWireSize = (uwWireSize+1)&0xFFFE;
 
   // Packet read loop
   uint16_t uwReadSize = 0;
-  uint8_t *ptr = g_pDataBuffer;
+  uint8_t *ptr = g_pDataBuffer + pb_proto_headroom;
   uint8_t ubPOutWait = 1;
-  while(uwSize--) {
+  while(uwWireSize--) {
     ubStatus = parWaitForPout(ubPOutWait, PBPROTO_STAGE_DATA);
     if(ubStatus != PBPROTO_STATUS_OK)
       break;
@@ -165,6 +205,9 @@ static uint8_t parHandleAmiWrite(uint16_t *pReadSize)
     uwReadSize++;
 	}
 
+  // Don't pass padding byte along
+  if(uwReadSize > uwSize)
+    uwReadSize = uwSize;
   *pReadSize = uwReadSize;
   return ubStatus;
 }
@@ -209,9 +252,9 @@ static uint8_t parHandleAmiRead(uint16_t uwSize, uint16_t *pWriteSize)
   const uint8_t *ptr = g_pDataBuffer;
   uint8_t ubPOutWait = 1;
   // Original plipbox had following loop operating on words, so size has to be
-  // rounded up
-  // TODO(KaiN#9): Make odd transfers safe?
-  uwSize = (uwSize+1)&0xFFFE;
+  // rounded up unless Amiga negotiated exact transfers
+  if(!(pb_proto_flags & PBPROTO_FLAG_EXACT_SIZE))
+    uwSize = (uwSize+1)&0xFFFE;
   while(uwSize--) {
     ubStatus = parWaitForPout(ubPOutWait, PBPROTO_STAGE_DATA);
     if(ubStatus != PBPROTO_STATUS_OK)
@@ -222,9 +265,9 @@ static uint8_t parHandleAmiRead(uint16_t uwSize, uint16_t *pWriteSize)
     ubPOutWait ^= 1;
   }
 
-  // Final wait
+  // Final wait - Amiga toggles POUT once more after reading last byte
   if(ubStatus == PBPROTO_STATUS_OK)
-    ubStatus = parWaitForPout(1, PBPROTO_STAGE_LAST_DATA);
+    ubStatus = parWaitForPout(ubPOutWait, PBPROTO_STAGE_LAST_DATA);
 
   // [IN]
   PAR_DATA_DDR = 0x00;
@@ -235,9 +278,84 @@ static uint8_t parHandleAmiRead(uint16_t uwSize, uint16_t *pWriteSize)
 
 // ---------- BURST ----------
 
-static uint8_t parHandleAmiWriteBurst(uint16_t *ret_size)
+/**
+ * Burst loops below sample PAR_STATUS_PIN once per POUT edge and check
+ * both POUT and SEL in that single sample.
+ * Both functions return number of words left - non-zero means SEL got lost.
+ */
+
+/**
+ * Receives words from Amiga - Amiga puts byte and toggles POUT.
+ * @param pData Destination buffer.
+ * @param uwWords Number of words to receive.
+ * @return Number of words not received.
+ */
+static uint16_t parBurstLoopAmiWrite(uint8_t *pData, uint16_t uwWords) {
+	uint8_t ubIn;
+	while(uwWords) {
+		// wait REQ == 1
+		do
+			ubIn = PAR_STATUS_PIN;
+		while((ubIn & (PAR_SEL | PAR_POUT)) == PAR_SEL);
+		if(!(ubIn & PAR_SEL))
+			break;
+		*(pData++) = PAR_DATA_PIN;
+
+		// wait REQ == 0
+		do
+			ubIn = PAR_STATUS_PIN;
+		while((ubIn & (PAR_SEL | PAR_POUT)) == (PAR_SEL | PAR_POUT));
+		if(!(ubIn & PAR_SEL))
+			break;
+		*(pData++) = PAR_DATA_PIN;
+		--uwWords;
+	}
+	return uwWords;
+}
+
+/**
+ * Sends words to Amiga - Amiga reads byte and toggles POUT, AVR puts next
+ * byte after given delay.
+ * @param pData Source buffer.
+ * @param uwWords Number of words to send.
+ * @param ubDelay Delay loop count before putting each byte, 3 cycles each.
+ * @return Number of words not sent.
+ */
+static uint16_t parBurstLoopAmiRead(
+	const uint8_t *pData, uint16_t uwWords, uint8_t ubDelay
+) {
+	uint8_t ubIn;
+	while(uwWords) {
+		_delay_loop_1(ubDelay);
+		PAR_DATA_PORT = *(pData++);
+
+		// wait REQ == 0
+		do
+			ubIn = PAR_STATUS_PIN;
+		while((ubIn & (PAR_SEL | PAR_POUT)) == (PAR_SEL | PAR_POUT));
+		if(!(ubIn & PAR_SEL))
+			break;
+
+		_delay_loop_1(ubDelay);
+		PAR_DATA_PORT = *(pData++);
+
+		// wait REQ == 1
+		do
+			ubIn = PAR_STATUS_PIN;
+		while((ubIn & (PAR_SEL | PAR_POUT)) == PAR_SEL);
+		if(!(ubIn & PAR_SEL))
+			break;
+		--uwWords;
+	}
+	return uwWords;
+}
+
+/**
+ * Receives packet size from Amiga before burst transfer.
+ * Size lo isn't acknowledged - it's done by starting burst.
+ */
+static uint8_t parAmiWriteBurstSize(uint16_t *pSize)
 {
-  uint16_t uwSize;
   uint8_t ubStatus;
 
   // --- packet size hi ---
@@ -245,7 +363,7 @@ static uint8_t parHandleAmiWriteBurst(uint16_t *ret_size)
   if(ubStatus != PBPROTO_STATUS_OK)
     return ubStatus;
 
-  uwSize = PAR_DATA_PIN << 8;
+  *pSize = PAR_DATA_PIN << 8;
   PAR_STATUS_PORT &= ~PAR_BUSY;
 
   // --- packet size lo ---
@@ -253,45 +371,94 @@ static uint8_t parHandleAmiWriteBurst(uint16_t *ret_size)
   if(ubStatus != PBPROTO_STATUS_OK)
     return ubStatus;
 
-  uwSize |= PAR_DATA_PIN;
+  *pSize |= PAR_DATA_PIN;
   // delay SET_RAK until burst begin...
+  return PBPROTO_STATUS_OK;
+}
+
+/**
+ * Receives bytes from Amiga straight into ENC28J60 - same handshake as in
+ * parBurstLoopAmiWrite(), but each byte is also written to SPDR. Bytes are
+ * still stored in pData, so that bridge may look into packet afterwards.
+ * SPI must be selected with ENC28J60 write buffer command already sent.
+ * @param pData Destination buffer.
+ * @param uwBytes Number of bytes to receive, must be even.
+ * @return Number of bytes not received.
+ */
+static uint16_t parBurstLoopAmiWriteSpi(uint8_t *pData, uint16_t uwBytes) {
+	uint8_t ubIn, ubData;
+	uint8_t ubPout = 0;
+	while(uwBytes) {
+		// wait for POUT toggle
+		ubPout ^= PAR_POUT;
+		do
+			ubIn = PAR_STATUS_PIN;
+		while((ubIn & (PAR_SEL | PAR_POUT)) == (PAR_SEL | (ubPout ^ PAR_POUT)));
+		if(!(ubIn & PAR_SEL))
+			break;
+		ubData = PAR_DATA_PIN;
+		*(pData++) = ubData;
+		spiWriteByte(ubData);
+		--uwBytes;
+	}
+	return uwBytes;
+}
 
+/**
+ * Receives burst data from Amiga.
+ * @param uwSize Packet size.
+ * @param ubStream If set, packet is also streamed into ENC28J60 TX buffer.
+ * @param ret_size Number of bytes received.
+ */
+static uint8_t parAmiWriteBurstData(
+  uint16_t uwSize, uint8_t ubStream, uint16_t *ret_size
+)
+{
   // check size
-  if(uwSize > DATABUF_SIZE)
+  if(uwSize > parMaxWriteSize())
     return PBPROTO_STATUS_PACKET_TOO_LARGE;
+  if(ubStream)
+    enc28j60_send_stream_begin(pb_proto_headroom);
 
-  // round to even and convert to words
-  uint16_t words = (uwSize +1) >> 1;
+  // convert to words - odd byte is padded to full word or, with exact
+  // transfers, read after burst loop
+  uint8_t ubLastByte = (pb_proto_flags & PBPROTO_FLAG_EXACT_SIZE) && (uwSize & 1);
+  uint16_t words = ubLastByte ? (uwSize >> 1) : ((uwSize + 1) >> 1);
   uint16_t i;
   uint8_t result = PBPROTO_STATUS_OK;
-  uint8_t *ptr = g_pDataBuffer;
+  uint8_t *ptr = g_pDataBuffer + pb_proto_headroom;
 
   // ----- burst loop -----
   // BEGIN TIME CRITICAL
   cli();
   PAR_STATUS_PORT ^= PAR_BUSY; // trigger start of burst
-  for(i=0;i<words;i++) {
-    // wait REQ == 1
-    while(!(PAR_STATUS_PIN & PAR_POUT) && (PAR_STATUS_PIN & PAR_SEL)) {}
-		if(!(PAR_STATUS_PIN & PAR_SEL))
-			break;
-    *(ptr++) = PAR_DATA_PIN;
-
-    // wait REQ == 0
-    while((PAR_STATUS_PIN & PAR_POUT) && (PAR_STATUS_PIN & PAR_SEL)) {}
-		if(!(PAR_STATUS_PIN & PAR_SEL))
-			break;
-    *(ptr++) = PAR_DATA_PIN;
-  }
+  uint16_t uwStart = TCNT1;
+  if(ubStream)
+    i = words - ((parBurstLoopAmiWriteSpi(ptr, words << 1) + 1) >> 1);
+  else
+    i = words - parBurstLoopAmiWrite(ptr, words);
+  uint16_t uwCycles = TCNT1 - uwStart;
   sei();
   // END TIME CRITICAL
 
+  // Amiga's pace, used by parCalibrateBurst()
+  if(i == words && words && words <= BURST_CALIB_MAX_WORDS)
+    s_uwBurstWordCycles = uwCycles / words;
+
   do {
 		// Wait for POUT == 1
 		while(!(PAR_STATUS_PIN & PAR_POUT) && (PAR_STATUS_PIN & PAR_SEL));
 		if(!(PAR_STATUS_PIN & PAR_SEL))
 			continue;
 
+		// Odd byte comes with this POUT edge
+		if(ubLastByte && i == words) {
+			uint8_t ubData = PAR_DATA_PIN;
+			ptr[uwSize - 1] = ubData;
+			if(ubStream)
+				spiWriteByte(ubData);
+		}
+
 		PAR_STATUS_PORT ^= PAR_BUSY;
 		// Wait for POUT == 0
 		while((PAR_STATUS_PIN & PAR_POUT) && (PAR_STATUS_PIN & PAR_SEL));
@@ -301,19 +468,22 @@ static uint8_t parHandleAmiWriteBurst(uint16_t *ret_size)
   if(i<words)
     result = PBPROTO_STATUS_TIMEOUT | PBPROTO_STAGE_DATA;
 
+  // Frame is sent by bridge only if it was received completely
+  if(ubStream)
+    enc28j60_send_stream_end();
+
   // final ACK
 	PAR_STATUS_PORT ^= PAR_BUSY;
 
-  *ret_size = i << 1;
+  *ret_size = (i == words) ? uwSize : (i << 1);
   return result;
 }
 
 /**
- * Sends data from AVR to Amiga in burst mode
- * AVR doesn't acknowledge sending next part of data, so Amiga just reads
- * as fast as it can and acks every byte read
+ * Sends packet size to Amiga before burst transfer.
+ * Data lines are left as outputs.
  */
-static uint8_t parHandleAmiReadBurst(uint16_t size, uint16_t *ret_size) {
+static uint8_t parAmiReadBurstSize(uint16_t size) {
   uint8_t status;
 
   // --- set packet size hi
@@ -332,70 +502,266 @@ static uint8_t parHandleAmiReadBurst(uint16_t size, uint16_t *ret_size) {
 
 	PAR_DATA_PORT = size & 0xFF;
 	PAR_STATUS_PORT ^= PAR_BUSY;
+  return PBPROTO_STATUS_OK;
+}
+
+/**
+ * Sends bytes to Amiga straight from ENC28J60 - same handshake as in
+ * parBurstLoopAmiRead(), but each byte is taken from SPDR. SPI read of next
+ * byte is started right after current one is put on data lines, so it
+ * overlaps with Amiga reading it. BUSY is toggled here, once first byte
+ * is already on data lines.
+ * SPI must be selected with ENC28J60 read buffer command already sent.
+ * Written in C on both platforms since SPI transfer takes longer than
+ * handshake code anyway.
+ * @param uwBytes Number of bytes to send.
+ * @param ubDelay Delay loop count before putting each byte, 3 cycles each.
+ * @return Number of bytes not sent.
+ */
+static uint16_t parBurstLoopAmiReadSpi(uint16_t uwBytes, uint8_t ubDelay) {
+	uint8_t ubIn, ubData;
+	uint8_t ubPout = PAR_POUT;
+
+	// First byte must be on data lines before BUSY tells Amiga to read it
+	if(uwBytes) {
+		SPDR = 0;
+		while(!(SPSR & _BV(SPIF)));
+		PAR_DATA_PORT = SPDR;
+		if(uwBytes > 1)
+			SPDR = 0;
+	}
+	PAR_STATUS_PORT ^= PAR_BUSY;
+
+	while(uwBytes) {
+		// wait for POUT toggle
+		ubPout ^= PAR_POUT;
+		do
+			ubIn = PAR_STATUS_PIN;
+		while((ubIn & (PAR_SEL | PAR_POUT)) == (PAR_SEL | (ubPout ^ PAR_POUT)));
+		if(!(ubIn & PAR_SEL)) {
+			// Finish started transfer before anyone deselects SPI
+			if(uwBytes > 1)
+				while(!(SPSR & _BV(SPIF)));
+			break;
+		}
+		if(!--uwBytes)
+			break;
+
+		while(!(SPSR & _BV(SPIF)));
+		ubData = SPDR;
+		if(uwBytes > 1)
+			SPDR = 0;
+		_delay_loop_1(ubDelay);
+		PAR_DATA_PORT = ubData;
+	}
+	return uwBytes;
+}
+
+static uint8_t parHandleAmiWriteBurst(uint8_t ubStream, uint16_t *ret_size)
+{
+  uint16_t uwSize;
+  uint8_t ubStatus = parAmiWriteBurstSize(&uwSize);
+  if(ubStatus != PBPROTO_STATUS_OK)
+    return ubStatus;
+  return parAmiWriteBurstData(uwSize, ubStream, ret_size);
+}
+
+/**
+ * Receives many frames from Amiga in single SEL cycle.
+ * Each frame goes as in send_burst and is passed to bridgeProcessPacket()
+ * before AVR takes size of next one, so Amiga waits for BUSY meanwhile.
+ * Zero size ends the batch and is acknowledged by toggling BUSY.
+ * @param ubStream If set, frames are also streamed into ENC28J60 TX buffer.
+ * @param ret_size Total number of bytes received.
+ */
+static uint8_t parHandleAmiWriteBatch(uint8_t ubStream, uint16_t *ret_size)
+{
+  uint16_t uwTotal = 0;
+  uint8_t ubStatus;
+  uint8_t ubRefused = 0;
+
+  for(;;) {
+    uint16_t uwSize;
+    ubStatus = parAmiWriteBurstSize(&uwSize);
+    if(ubStatus != PBPROTO_STATUS_OK)
+      break;
+    if(!uwSize) {
+      PAR_STATUS_PORT ^= PAR_BUSY;
+      break;
+    }
+
+    uint16_t uwRead;
+    ubStatus = parAmiWriteBurstData(uwSize, ubStream, &uwRead);
+    uwTotal += uwRead;
+    if(ubStatus != PBPROTO_STATUS_OK)
+      break;
+    // Batch goes on past frame refused by bridge, it's reported once it ends
+    if(bridgeProcessPacket(uwRead, ubStream) != PBPROTO_STATUS_OK)
+      ubRefused = 1;
+  }
+
+  *ret_size = uwTotal;
+  if(ubStatus == PBPROTO_STATUS_OK && ubRefused)
+    return PBPROTO_STATUS_PACKET_TOO_LARGE;
+  return ubStatus;
+}
+
+/**
+ * Sends data from AVR to Amiga in burst mode
+ * AVR doesn't acknowledge sending next part of data, so Amiga just reads
+ * as fast as it can and acks every byte read
+ * @param size Packet size.
+ * @param ubStream If set, packet is streamed from ENC28J60 instead of being
+ *        sent from g_pDataBuffer. Stream gets ended in all cases.
+ * @param ret_size Number of bytes sent.
+ */
+static uint8_t parHandleAmiReadBurst(
+  uint16_t size, uint8_t ubStream, uint16_t *ret_size
+) {
+  uint8_t status;
+
+  status = parAmiReadBurstSize(size);
 
   // --- burst ready? ---
-  status = parWaitForPout(1, PBPROTO_STAGE_DATA);
-  if(status != PBPROTO_STATUS_OK)
+  if(status == PBPROTO_STATUS_OK)
+    status = parWaitForPout(1, PBPROTO_STAGE_DATA);
+  if(status != PBPROTO_STATUS_OK) {
+    if(ubStream)
+      enc28j60_recv_stream_end();
     return status;
+  }
 
-  // round to even and convert to words
-  uint16_t words = (size + 1) >> 1;
+  // convert to words - odd byte is padded to full word or, with exact
+  // transfers, sent after burst loop
+  uint8_t ubLastByte = (pb_proto_flags & PBPROTO_FLAG_EXACT_SIZE) && (size & 1);
+  uint16_t words = ubLastByte ? (size >> 1) : ((size + 1) >> 1);
   uint8_t result = PBPROTO_STATUS_OK;
   uint16_t i;
-  uint8_t *ptr = g_pDataBuffer;
+  const uint8_t *ptr = g_pDataBuffer;
 
   // ----- burst loop -----
   // BEGIN TIME CRITICAL
   cli();
-	PAR_STATUS_PORT ^= PAR_BUSY;
-  for(i=0;i<words;i++) {
-    BURST_DELAY;
-    PAR_DATA_PORT = *(ptr++);
-
-    // wait REQ == 0
-    while((PAR_STATUS_PIN & PAR_POUT) && (PAR_STATUS_PIN & PAR_SEL)) {}
-		if(!(PAR_STATUS_PIN & PAR_SEL))
-			break;
-
-    BURST_DELAY;
-    PAR_DATA_PORT = *(ptr++);
-
-    // wait REQ == 1
-    while(!(PAR_STATUS_PIN & PAR_POUT) && (PAR_STATUS_PIN & PAR_SEL)) {}
-		if(!(PAR_STATUS_PIN & PAR_SEL))
-			break;
+  if(ubStream) {
+    // BUSY is toggled once first byte is fetched from ENC28J60
+    uint16_t uwBytes = (words << 1) + ubLastByte;
+    uint16_t uwLeft = parBurstLoopAmiReadSpi(uwBytes, s_ubBurstDelay);
+    // Odd last byte belongs to last word so that checks below work the same
+    i = uwLeft ? ((uwBytes - uwLeft) >> 1) : words;
+  }
+  else {
+    PAR_STATUS_PORT ^= PAR_BUSY;
+    i = words - parBurstLoopAmiRead(ptr, words, s_ubBurstDelay);
+    if(ubLastByte && i == words) {
+      _delay_loop_1(s_ubBurstDelay);
+      PAR_DATA_PORT = ptr[words << 1];
+    }
   }
-  recv_burst_exit:
   sei();
   // END TIME CRITICAL
 
-	// TODO(KaiN#9): WTF with label/goto
-  // final wait REQ == 0
-  while(PAR_STATUS_PIN & PAR_POUT)
-    if(!(PAR_STATUS_PIN & PAR_SEL))
-			goto recv_burst_exit;
-
-	PAR_STATUS_PORT |= PAR_BUSY;
+  do {
+		// Wait for POUT == 0
+		while((PAR_STATUS_PIN & PAR_POUT) && (PAR_STATUS_PIN & PAR_SEL));
+		if(!(PAR_STATUS_PIN & PAR_SEL))
+			continue;
 
-  // final wait REQ == 1
-  while(!(PAR_STATUS_PIN & PAR_POUT))
-    if(!(PAR_STATUS_PIN & PAR_SEL))
-			goto recv_burst_exit;
+		PAR_STATUS_PORT |= PAR_BUSY;
+		// Wait for POUT == 1
+		while(!(PAR_STATUS_PIN & PAR_POUT) && (PAR_STATUS_PIN & PAR_SEL));
+  } while(!(PAR_STATUS_PIN & PAR_SEL));
 
   // error?
   if(i<words)
     result = PBPROTO_STATUS_TIMEOUT | PBPROTO_STAGE_DATA;
 
+  // Free frame in ENC28J60 while Amiga still waits for final ACK - it may
+  // start next transfer right after it
+  if(ubStream)
+    enc28j60_recv_stream_end();
+
   // final ACK
 	PAR_STATUS_PORT &= ~PAR_BUSY;
 
   // [IN]
   PAR_DATA_DDR = 0x00;
 
-  *ret_size = i << 1;
+  *ret_size = (i == words) ? size : (i << 1);
   return result;
 }
 
+/**
+ * Sends frames queued in ENC28J60 to Amiga in single SEL cycle.
+ * Each frame goes as in recv_burst. Then Amiga sets POUT=0 and AVR fetches
+ * next frame before confirming with BUSY=1. Zero size ends the batch.
+ * @param size Size of first frame.
+ * @param ubStream If set, first frame is streamed, else it's in g_pDataBuffer.
+ *        Next frames are streamed if Amiga is slow enough for that.
+ * @param ret_size Total number of bytes sent.
+ */
+static uint8_t parHandleAmiReadBatch(
+  uint16_t size, uint8_t ubStream, uint16_t *ret_size
+) {
+  uint8_t status;
+  uint8_t ubFrames = 0;
+  uint16_t uwTotal = 0;
+
+  while(size) {
+    uint16_t uwSent;
+    status = parHandleAmiReadBurst(size, ubStream, &uwSent);
+    uwTotal += uwSent;
+    if(status != PBPROTO_STATUS_OK) {
+      *ret_size = uwTotal;
+      return status;
+    }
+
+    // Amiga stores frame meanwhile
+    size = 0;
+    ubStream = s_ubBurstStream;
+    if(++ubFrames < PBPROTO_BATCH_MAX_FRAMES)
+      bridgeFillNextPacket(&size, ubStream);
+
+    // --- ready for next one ---
+    status = parWaitForPout(0, PBPROTO_STAGE_BATCH_NEXT);
+    if(status != PBPROTO_STATUS_OK) {
+      if(size && ubStream)
+        enc28j60_recv_stream_end();
+      *ret_size = uwTotal;
+      return status;
+    }
+    PAR_STATUS_PORT |= PAR_BUSY;
+  }
+
+  // End of batch - keep size on data lines until Amiga drops SEL
+  status = parAmiReadBurstSize(0);
+  if(status == PBPROTO_STATUS_OK)
+    status = parWaitForSel(0, PBPROTO_STAGE_END_SELECT);
+  PAR_DATA_DDR = 0x00;
+  *ret_size = uwTotal;
+  return status;
+}
+
+/**
+ * Picks recv_burst delay based on Amiga's pace in last send_burst.
+ * Amiga toggles POUT once per byte, so delay is set to half of its byte
+ * period, bounded by PBPROTO_BURST_DELAY_MIN/MAX. Faster Amigas get
+ * proportionally shorter delay, slow ones stay at the safe maximum.
+ * Streaming from ENC28J60 is disabled if Amiga reads faster than SPI.
+ */
+void parCalibrateBurst(void) {
+	if(!s_uwBurstWordCycles)
+		return;
+	// word period / 2 bytes / 2 / 3 cycles per loop
+	uint16_t uwLoops = s_uwBurstWordCycles / 12;
+	if(uwLoops < PBPROTO_BURST_DELAY_MIN)
+		uwLoops = PBPROTO_BURST_DELAY_MIN;
+	else if(uwLoops > PBPROTO_BURST_DELAY_MAX)
+		uwLoops = PBPROTO_BURST_DELAY_MAX;
+	s_ubBurstDelay = uwLoops;
+	s_ubBurstStream = (s_uwBurstWordCycles >= 2 * BURST_STREAM_MIN_CYCLES);
+	s_ubBurstTimeouts = 0;
+}
+
 /**
  * Handles communication with Amiga.
  * This function does the following:
@@ -425,14 +791,28 @@ uint8_t pb_proto_handle(void) {
 
   // Amiga wants to receive data - prepare
   uint16_t pkt_size = 0;
-  if((cmd == PBPROTO_CMD_RECV) || (cmd == PBPROTO_CMD_RECV_BURST)) {
-    uint8_t res = bridgeFillPacket(&pkt_size);
+  uint8_t ubStream = 0;
+  if(
+    (cmd == PBPROTO_CMD_RECV) || (cmd == PBPROTO_CMD_RECV_BURST) ||
+    (cmd == PBPROTO_CMD_RECV_BATCH)
+  ) {
+    // Bursts stream frames straight from ENC28J60 unless Amiga reads faster
+    // than SPI can deliver, plain recv needs buffer
+    uint8_t res = bridgeFillPacket(
+      &pkt_size, (cmd != PBPROTO_CMD_RECV && s_ubBurstStream) ? &ubStream : 0
+    );
     if(res != PBPROTO_STATUS_OK) {
       ps->status = res;
 			stats_get(ps->stats_id)->err++;
       return res;
     }
   }
+  else if(
+    (cmd == PBPROTO_CMD_SEND_BURST) || (cmd == PBPROTO_CMD_SEND_BATCH)
+  ) {
+    // Burst sends stream frames straight into ENC28J60 under same conditions
+    ubStream = s_ubBurstStream;
+  }
 
   // start timer
   uint32_t ts = g_uwTimeStamp;
@@ -450,10 +830,16 @@ uint8_t pb_proto_handle(void) {
       result = parHandleAmiWrite(&uwParDataSize);
       break;
     case PBPROTO_CMD_RECV_BURST:
-      result = parHandleAmiReadBurst(pkt_size, &uwParDataSize);
+      result = parHandleAmiReadBurst(pkt_size, ubStream, &uwParDataSize);
       break;
     case PBPROTO_CMD_SEND_BURST:
-      result = parHandleAmiWriteBurst(&uwParDataSize);
+      result = parHandleAmiWriteBurst(ubStream, &uwParDataSize);
+      break;
+    case PBPROTO_CMD_RECV_BATCH:
+      result = parHandleAmiReadBatch(pkt_size, ubStream, &uwParDataSize);
+      break;
+    case PBPROTO_CMD_SEND_BATCH:
+      result = parHandleAmiWriteBatch(ubStream, &uwParDataSize);
       break;
     default:
       result = PBPROTO_STATUS_INVALID_CMD;
@@ -470,10 +856,23 @@ uint8_t pb_proto_handle(void) {
   // TODO(KaiN#7): is it really that short?
   uint16_t uwTimeDelta = timerGetState();
 
-  // Amiga sent data - process it
+  // Fall back to safe burst delay if Amiga can't keep up
+  if((cmd == PBPROTO_CMD_RECV_BURST) || (cmd == PBPROTO_CMD_RECV_BATCH)) {
+    if((result & 0x0F) == PBPROTO_STATUS_TIMEOUT) {
+      if(++s_ubBurstTimeouts >= BURST_TIMEOUT_FALLBACK) {
+        s_ubBurstDelay = PBPROTO_BURST_DELAY_MAX;
+        s_ubBurstStream = 0;
+        s_ubBurstTimeouts = 0;
+      }
+    }
+    else if(result == PBPROTO_STATUS_OK)
+      s_ubBurstTimeouts = 0;
+  }
+
+  // Amiga sent data - process it, batches were processed already
   if(result == PBPROTO_STATUS_OK) {
     if((cmd == PBPROTO_CMD_SEND) || (cmd == PBPROTO_CMD_SEND_BURST))
-      result = bridgeProcessPacket(uwParDataSize);
+      result = bridgeProcessPacket(uwParDataSize, ubStream);
   }
 
   // fill in stats
@@ -483,14 +882,19 @@ uint8_t pb_proto_handle(void) {
   ps->delta = uwTimeDelta;
   ps->rate = timerCalculateKbps(uwParDataSize, uwTimeDelta);
   ps->ts = ts;
-  ps->is_send = (cmd == PBPROTO_CMD_SEND) || (cmd == PBPROTO_CMD_SEND_BURST);
+  ps->is_send = (cmd == PBPROTO_CMD_SEND) || (cmd == PBPROTO_CMD_SEND_BURST) ||
+    (cmd == PBPROTO_CMD_SEND_BATCH);
   ps->stats_id = ps->is_send ? STATS_ID_PB_TX : STATS_ID_PB_RX;
   ps->recv_delta = ps->is_send ? 0 : (uint16_t)(ps->ts - trigger_ts);
 
 	if(result == PBPROTO_STATUS_OK)
 		stats_update_ok(ps->stats_id, ps->size, ps->rate);
-	else
+	else {
     stats_get(ps->stats_id)->err++;
+    // Frame was already taken out of ENC28J60 or g_pDataBuffer, it's gone
+    if(!ps->is_send && pkt_size)
+      stats_get(STATS_ID_PB_RX)->drop++;
+  }
 
   return result;
 }
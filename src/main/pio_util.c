@@ -43,7 +43,9 @@ uint8_t pio_util_recv_packet(uint16_t *pDataSize)
 {
   // Fetch packet from ENC28j60, measure elapsed time
   timerReset();
-  uint8_t ubRecvResult = enc28j60_recv(g_pDataBuffer, DATABUF_SIZE, pDataSize);
+  uint8_t ubRecvResult = enc28j60_recv(
+    g_pDataBuffer, DATABUF_SIZE + DATABUF_ROOM, pDataSize
+  );
   uint16_t uwTimeDelta = timerGetState();
   uint16_t uwDataRate = timerCalculateKbps(*pDataSize, uwTimeDelta);
 
@@ -51,6 +53,9 @@ uint8_t pio_util_recv_packet(uint16_t *pDataSize)
 		// Update stats - write new data size & rate
     stats_update_ok(STATS_ID_PIO_RX, *pDataSize, uwDataRate);
   }
+  else if(ubRecvResult == PIO_DROPPED) {
+    stats_get(STATS_ID_PIO_RX)->drop++;
+  }
   else {
 		// Update stats - increase error count
     stats_get(STATS_ID_PIO_RX)->err++;
@@ -59,6 +64,19 @@ uint8_t pio_util_recv_packet(uint16_t *pDataSize)
   return ubRecvResult;
 }
 
+uint8_t pio_util_recv_stream(uint16_t *pDataSize)
+{
+  // Data rate isn't known until packet gets streamed
+  uint8_t ubRecvResult = enc28j60_recv_stream_begin(pDataSize);
+  if(ubRecvResult == PIO_OK)
+    stats_update_ok(STATS_ID_PIO_RX, *pDataSize, 0);
+  else if(ubRecvResult == PIO_DROPPED)
+    stats_get(STATS_ID_PIO_RX)->drop++;
+  else
+    stats_get(STATS_ID_PIO_RX)->err++;
+  return ubRecvResult;
+}
+
 uint8_t pio_util_send_packet(uint16_t size)
 {
   timerReset();
@@ -76,3 +94,14 @@ uint8_t pio_util_send_packet(uint16_t size)
 
   return result;
 }
+
+uint8_t pio_util_send_streamed(uint16_t size)
+{
+  // Data rate isn't known since packet got streamed along with parallel burst
+  uint8_t result = enc28j60_send_stream_commit(g_pDataBuffer, size);
+  if(result == PIO_OK)
+    stats_update_ok(STATS_ID_PIO_TX, size, 0);
+  else
+    stats_get(STATS_ID_PIO_TX)->err++;
+  return result;
+}
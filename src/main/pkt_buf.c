@@ -7,4 +7,4 @@
 
 #include <main/pkt_buf.h>
 
-uint8_t g_pDataBuffer[DATABUF_SIZE];
+uint8_t g_pDataBuffer[DATABUF_SIZE + DATABUF_ROOM];
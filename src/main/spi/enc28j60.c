@@ -10,6 +10,9 @@
 #include <main/spi/enc28j60.h>
 #include <main/spi/spi.h>
 #include <main/pio.h>
+#include <main/stats.h>
+#include <main/net/eth.h>
+#include <main/net/ip.h>
 
 #ifdef NOENC
 #warning "No ENC28j60 mode! ###################################################"
@@ -38,10 +41,10 @@
 #define ERXST           (0x08|0x00)
 #define ERXND           (0x0A|0x00)
 #define ERXRDPT         (0x0C|0x00)
-// #define ERXWRPT         (0x0E|0x00)
+#define ERXWRPT         (0x0E|0x00)
 #define EDMAST          (0x10|0x00)
 #define EDMAND          (0x12|0x00)
-// #define EDMADST         (0x14|0x00)
+#define EDMADST         (0x14|0x00)
 #define EDMACS          (0x16|0x00)
 // Bank 1 registers
 #define EHT0             (0x00|0x20)
@@ -61,7 +64,7 @@
 #define EPMM6            (0x0E|0x20)
 #define EPMM7            (0x0F|0x20)
 #define EPMCS           (0x10|0x20)
-// #define EPMO            (0x14|0x20)
+#define EPMO            (0x14|0x20)
 #define EWOLIE           (0x16|0x20)
 #define EWOLIR           (0x17|0x20)
 #define ERXFCON          (0x18|0x20)
@@ -210,6 +213,11 @@
 #define PHCON2_TXDIS     0x2000
 #define PHCON2_JABBER    0x0400
 #define PHCON2_HDLDIS    0x0100
+// ENC28J60 PHY PHIE/PHIR Register Bit Definitions
+#define PHIE_PLNKIE      0x0010
+#define PHIE_PGEIE       0x0002
+#define PHIR_PLNKIF      0x0010
+#define PHIR_PGIF        0x0004
 
 // ENC28J60 Packet Control Byte Bit Definitions
 #define PKTCTRL_PHUGEEN  0x08
@@ -235,10 +243,22 @@
 // 1518
 // sum: 1524
 
-#define RXSTART_INIT        0x0000  // start of RX buffer, room for 4 packets
-#define RXSTOP_INIT         0x19FF  // end of RX buffer
+// tx slot layout
+// 1 byte control
+// 1518
+// 7 byte status vector
+// sum: 1526
+
+// RX buffer takes what is left after TX ring of ENC28J60_TX_SLOTS_* slots,
+// e.g. 2 slots leave room for 3 max-sized frames, 4 slots - only for one
+
+#define TX_SLOT_SIZE        0x600   // room for 1 packet
 
-#define TXSTART_INIT        0x1A00  // start of TX buffer, room for 1 packet
+// Longest wait for free TX slot, in 100us ticks. Frame with all collision
+// retries and backoffs is long gone by then, so TX logic must be stuck.
+#define TX_SLOT_TIMEOUT     1000
+
+#define RXSTART_INIT        0x0000  // start of RX buffer
 #define TXSTOP_INIT         0x1FFF  // end of TX buffer
 
 // max frame length which the conroller will accept:
@@ -247,15 +267,103 @@
 
 static uint8_t Enc28j60Bank;
 static uint16_t gNextPacketPtr;
+static uint8_t s_ubRxPending; ///< Frames known to be in RX buffer, see has_recv
+#ifdef ETH_INT
+static uint8_t s_ubRxPollSkip; ///< has_recv() calls trusting idle ~INT in a row
+#endif
 static uint8_t is_full_duplex;
 static uint8_t rev;
 
+// SRAM partition, set up by enc28j60_init()
+static uint8_t s_ubTxSlots;  // slots in TX ring
+static uint16_t s_uwTxStart; // start of TX ring
+static uint16_t s_uwRxStop;  // end of RX buffer, right before TX ring
+
+// TX ring - frames are sent from s_ubTxHead onwards in queue order
+static uint16_t s_pTxSize[ENC28J60_TX_SLOTS_MAX];
+static uint8_t s_ubTxHead;  // slot being sent
+static uint8_t s_ubTxCount; // queued slots, including one being sent
+static uint8_t s_ubTxStreamRoom; // given to enc28j60_send_stream_begin()
+
+// Part of next received frame handed out, see enc28j60_set_rx_window()
+static uint8_t s_ubRxWinSkip;
+static uint16_t s_uwRxWinLen; // 0 if whole frame is wanted
+static uint8_t s_ubRxWinLead;  // see enc28j60_set_rx_lead()
+static uint8_t s_ubRxWinLeadSet;
+
+// Receive filter loaded by Amiga, survives re-init
+static enc28j60_filter_t s_sFilter;
+static uint8_t s_ubFilterSet;
+static uint8_t s_ubBroadcast; // PIO_INIT_BROAD_CAST given to init
+
+// Checksums of IPv4 frames are filled on send and checked on receive
+static uint8_t s_ubCsumOffload;
+
+// Buffer pointers mirrored in s_pPtrValue, so that bytes already held by chip
+// needn't be written again. Pointer is known only if its s_ubPtrKnown bit is set.
+#define PTR_ERDPT 0
+#define PTR_EWRPT 1
+#define PTR_ETXST 2
+#define PTR_ETXND 3
+#define PTR_COUNT 4
+static const uint8_t s_pPtrAddr[PTR_COUNT] = {ERDPT, EWRPT, ETXST, ETXND};
+static uint16_t s_pPtrValue[PTR_COUNT];
+static uint8_t s_ubPtrKnown;
+
 uint8_t g_ubEncOnline = 0;
+uint8_t g_ubEncLinkUp = 0;
+static uint8_t s_ubLinkPollSkip; // link_poll() calls since EIR was looked at
+static uint8_t s_ubLinkChanged;  // set by link_update(), cleared by link_poll()
+// SPI traffic since last frame was done or idle poll. Idle polls reset it,
+// so it can't outgrow single frame's traffic.
+static uint16_t s_uwFrameSpiBytes;
+static uint16_t s_uwFrameSpiSelects;
+
+/**
+ * Accounts bytes exchanged within already counted SPI transaction.
+ */
+static inline void spi_account_data(uint16_t bytes) {
+	s_uwFrameSpiBytes += bytes;
+}
+
+/**
+ * Accounts single ENC28J60 SPI transaction in stats.
+ * @param bytes Bytes exchanged during transaction, including opcode.
+ */
+static inline void spi_account(uint16_t bytes) {
+	++s_uwFrameSpiSelects;
+	spi_account_data(bytes);
+}
+
+/**
+ * Forgets SPI traffic of polls which found nothing to do.
+ */
+static inline void spi_account_idle(void) {
+	s_uwFrameSpiBytes = 0;
+	s_uwFrameSpiSelects = 0;
+}
+
+/**
+ * Stores SPI traffic since last frame as the one of frame just done.
+ * @param is_tx 1 if frame was queued for TX, 0 if taken from RX buffer.
+ */
+static void spi_account_frame(uint8_t is_tx) {
+	if(is_tx) {
+		stats_spi.tx_bytes = s_uwFrameSpiBytes;
+		stats_spi.tx_selects = s_uwFrameSpiSelects;
+	}
+	else {
+		stats_spi.rx_bytes = s_uwFrameSpiBytes;
+		stats_spi.rx_selects = s_uwFrameSpiSelects;
+	}
+	spi_account_idle();
+}
 
 static uint8_t readOp (uint8_t op, uint8_t address) {
 	#ifdef NOENC
 	return 0;
 	#endif
+	spi_account((address & 0x80) ? 3 : 2);
 	spiEnableEth();
 	spiWriteByte(op | (address & ADDR_MASK));
 	if (address & 0x80)
@@ -269,33 +377,38 @@ static void writeOp (uint8_t op, uint8_t address, uint8_t data) {
 	#ifdef NOENC
 	return;
 	#endif
+	spi_account(2);
 	spiEnableEth();
 	spiWriteByte(op | (address & ADDR_MASK));
 	spiWriteByte(data);
 	spiDisableEth();
 }
 
-static void readBuf(uint16_t len, uint8_t* data) {
+/**
+ * Reads bytes from buffer memory at ERDPT within already selected
+ * ENC28J60_READ_BUF_MEM transaction.
+ */
+static void readBufData(uint16_t len, uint8_t* data) {
 	#ifdef NOENC
 	return;
 	#endif
-	spiEnableEth();
-	spiWriteByte(ENC28J60_READ_BUF_MEM);
-	while (len--) {
-		*data++ = spiReadByte();
-	}
-	spiDisableEth();
+	spi_account_data(len);
+	spiReadBlock(data, len);
 }
 
 static void SetBank (uint8_t address) {
 	#ifdef NOENC
 	return;
 	#endif
-	if ((address & BANK_MASK) != Enc28j60Bank) {
-		writeOp(ENC28J60_BIT_FIELD_CLR, ECON1, ECON1_BSEL1|ECON1_BSEL0);
-		Enc28j60Bank = address & BANK_MASK;
-		writeOp(ENC28J60_BIT_FIELD_SET, ECON1, Enc28j60Bank>>5);
-	}
+	// Touch only BSEL bits which differ - one op instead of two on most switches
+	uint8_t bank = address & BANK_MASK;
+	uint8_t clr = (Enc28j60Bank & ~bank) >> 5;
+	uint8_t set = (bank & ~Enc28j60Bank) >> 5;
+	if (clr)
+		writeOp(ENC28J60_BIT_FIELD_CLR, ECON1, clr);
+	if (set)
+		writeOp(ENC28J60_BIT_FIELD_SET, ECON1, set);
+	Enc28j60Bank = bank;
 }
 
 static uint8_t readRegByte (uint8_t address) {
@@ -306,14 +419,12 @@ static uint8_t readRegByte (uint8_t address) {
 	return readOp(ENC28J60_READ_CTRL_REG, address);
 }
 
-#if 0
 static uint16_t readReg(uint8_t address) {
 	#ifdef NOENC
 	return 0;
 	#endif
 	return readRegByte(address) + (readRegByte(address+1) << 8);
 }
-#endif
 
 static void writeRegByte (uint8_t address, uint8_t data) {
 	#ifdef NOENC
@@ -331,6 +442,50 @@ static void writeReg(uint8_t address, uint16_t data) {
 	writeRegByte(address + 1, data >> 8);
 }
 
+/**
+ * Sets buffer pointer, skipping bytes which chip already holds.
+ * @param ptr Pointer index, one of PTR_*.
+ * @param value New pointer value.
+ */
+static void writePtr(uint8_t ptr, uint16_t value) {
+	#ifdef NOENC
+	return;
+	#endif
+	uint8_t address = s_pPtrAddr[ptr];
+	uint8_t known = s_ubPtrKnown & _BV(ptr);
+	uint16_t old = s_pPtrValue[ptr];
+	if (!known || (uint8_t)old != (uint8_t)value)
+		writeRegByte(address, value);
+	if (!known || (old >> 8) != (value >> 8))
+		writeRegByte(address + 1, value >> 8);
+	s_pPtrValue[ptr] = value;
+	s_ubPtrKnown |= _BV(ptr);
+}
+
+/**
+ * Marks pointer as changed by chip in a way which can't be followed.
+ */
+static inline void forgetPtr(uint8_t ptr) {
+	s_ubPtrKnown &= ~_BV(ptr);
+}
+
+/**
+ * Overwrites big endian word in buffer memory.
+ */
+static void writeBufWord(uint16_t addr, uint16_t value) {
+	#ifdef NOENC
+	return;
+	#endif
+	writePtr(PTR_EWRPT, addr);
+	spi_account(3);
+	spiEnableEth();
+	spiWriteByte(ENC28J60_WRITE_BUF_MEM);
+	spiWriteByte(value >> 8);
+	spiWriteByte(value);
+	spiDisableEth();
+	s_pPtrValue[PTR_EWRPT] = addr + 2;
+}
+
 static uint16_t readPhyByte (uint8_t address) {
 	#ifdef NOENC
 	return 0;
@@ -342,6 +497,17 @@ static uint16_t readPhyByte (uint8_t address) {
 	return readRegByte(MIRD+1);
 }
 
+static uint16_t readPhy (uint8_t address) {
+	#ifdef NOENC
+	return 0;
+	#endif
+	writeRegByte(MIREGADR, address);
+	writeRegByte(MICMD, MICMD_MIIRD);
+	while (readRegByte(MISTAT) & MISTAT_BUSY);
+	writeRegByte(MICMD, 0x00);
+	return readReg(MIRD);
+}
+
 static void writePhy (uint8_t address, uint16_t data) {
 	#ifdef NOENC
 	return;
@@ -371,8 +537,63 @@ static inline void enc28j60_disable_broadcast ( void )
   writeRegByte(ERXFCON, ERXFCON_UCEN|ERXFCON_CRCEN/*|ERXFCON_PMEN*/);
 }
 
+/**
+ * Writes receive filter into chip - either one loaded by Amiga or default
+ * unicast filter, with broadcasts passed if init asked for them.
+ */
+static void apply_filter(void)
+{
+	#ifdef NOENC
+	return;
+	#endif
+  if(!s_ubFilterSet) {
+    if(s_ubBroadcast) {
+      enc28j60_enable_broadcast(); // change to add ERXFCON_BCEN recommended by epam
+    } else {
+      enc28j60_disable_broadcast(); // change to add ERXFCON_BCEN recommended by epam
+    }
+    return;
+  }
+
+  // Tables first, so that filter is never enabled with stale ones
+  for(uint8_t i = 0; i < 8; ++i) {
+    writeRegByte(EHT0 + i, s_sFilter.hash[i]);
+    writeRegByte(EPMM0 + i, s_sFilter.pattern_mask[i]);
+  }
+  writeRegByte(EPMCS, s_sFilter.pattern_csum[1]);
+  writeRegByte(EPMCS + 1, s_sFilter.pattern_csum[0]);
+  writeRegByte(EPMO, s_sFilter.pattern_offs[1]);
+  writeRegByte(EPMO + 1, s_sFilter.pattern_offs[0]);
+  writeRegByte(ERXFCON, s_sFilter.flags | ERXFCON_CRCEN);
+}
+
+/**
+ * Replaces receive filter, also for subsequent enc28j60_init() calls.
+ * @param filter Filter to use, or zero to go back to default one.
+ */
+void enc28j60_set_filter(const enc28j60_filter_t *filter)
+{
+	#ifdef NOENC
+	return;
+	#endif
+  s_ubFilterSet = filter != 0;
+  if(filter) {
+    s_sFilter = *filter;
+  }
+  apply_filter();
+}
+
 // TODO(KaiN#1): merge flags with pio_util_get_init_flags()?
-uint8_t enc28j60_init(const uint8_t macaddr[6], uint8_t flags)
+/**
+ * Resets and configures ENC28J60.
+ * @param macaddr MAC address to use.
+ * @param flags PIO_INIT_* flags.
+ * @param tx_slots Frames which may be queued for sending, 8K buffer memory
+ *        is shared with RX buffer - see ENC28J60_TX_SLOTS_*. Values out of
+ *        range give ENC28J60_TX_SLOTS_DEFAULT.
+ * @return PIO_OK on success, otherwise PIO_NOT_FOUND.
+ */
+uint8_t enc28j60_init(const uint8_t macaddr[6], uint8_t flags, uint8_t tx_slots)
 {
 	#ifdef NOENC
 	return 0;
@@ -382,10 +603,13 @@ uint8_t enc28j60_init(const uint8_t macaddr[6], uint8_t flags)
   spiDisableEth();
 
   is_full_duplex = (flags & PIO_INIT_FULL_DUPLEX) == PIO_INIT_FULL_DUPLEX;
+  s_ubBroadcast = (flags & PIO_INIT_BROAD_CAST) == PIO_INIT_BROAD_CAST;
 
   // soft reset cpu
   writeOp(ENC28J60_SOFT_RESET, 0, ENC28J60_SOFT_RESET);
   timerDelay100us(20); // errata B7/2
+  Enc28j60Bank = 0;
+  s_ubPtrKnown = 0;
 
   // wait or error
   uint16_t count = 0;
@@ -397,24 +621,26 @@ uint8_t enc28j60_init(const uint8_t macaddr[6], uint8_t flags)
     }
   }
 
+  // split buffer memory between TX ring and RX buffer
+  if(tx_slots < ENC28J60_TX_SLOTS_MIN || tx_slots > ENC28J60_TX_SLOTS_MAX)
+    tx_slots = ENC28J60_TX_SLOTS_DEFAULT;
+  s_ubTxSlots = tx_slots;
+  s_uwTxStart = TXSTOP_INIT + 1 - tx_slots * TX_SLOT_SIZE;
+  s_uwRxStop = s_uwTxStart - 1;
+
   // set packet pointers
   gNextPacketPtr = RXSTART_INIT;
+  s_ubRxPending = 0;
+  s_ubTxHead = 0;
+  s_ubTxCount = 0;
   writeReg(ERXST, RXSTART_INIT);
   writeReg(ERXRDPT, RXSTART_INIT);
-  writeReg(ERXND, RXSTOP_INIT);
-  writeReg(ETXST, TXSTART_INIT);
-  writeReg(ETXND, TXSTOP_INIT);
+  writeReg(ERXND, s_uwRxStop);
+  writePtr(PTR_ETXST, s_uwTxStart);
+  writePtr(PTR_ETXND, TXSTOP_INIT);
 
   // set packet filter
-  if(flags & PIO_INIT_BROAD_CAST) {
-    enc28j60_enable_broadcast(); // change to add ERXFCON_BCEN recommended by epam
-  } else {
-    enc28j60_disable_broadcast(); // change to add ERXFCON_BCEN recommended by epam
-  }
-
-  // BIST pattern generator?
-  writeReg(EPMM0, 0x303f);
-  writeReg(EPMCS, 0xf7f9);
+  apply_filter();
 
   // MAC init (with flow control)
   writeRegByte(MACON1, MACON1_MARXEN|MACON1_TXPAUS|MACON1_RXPAUS);
@@ -442,6 +668,10 @@ uint8_t enc28j60_init(const uint8_t macaddr[6], uint8_t flags)
     writePhy(PHCON1, 0);
     writePhy(PHCON2, PHCON2_HDLDIS);
   }
+  // Link changes raise LINKIF, reading PHIR clears it
+  writePhy(PHIE, PHIE_PGEIE | PHIE_PLNKIE);
+  readPhy(PHIR);
+  g_ubEncLinkUp = (readPhyByte(PHSTAT2) >> 2) & 1;
 
   // prepare flow control
   writeReg(EPAUS, 20 * 100); // 100ms
@@ -463,7 +693,12 @@ uint8_t enc28j60_init(const uint8_t macaddr[6], uint8_t flags)
   writeRegByte(MAADR0, macaddr[5]);
 
   SetBank(ECON1);
-  writeOp(ENC28J60_BIT_FIELD_SET, EIE, EIE_INTIE|EIE_PKTIE);
+  // TX completion and link changes also pull ~INT, so tx_poll() and
+  // link_poll() may skip EIR reads
+  writeOp(
+    ENC28J60_BIT_FIELD_SET, EIE,
+    EIE_INTIE|EIE_PKTIE|EIE_TXIE|EIE_TXERIE|EIE_LINKIE
+  );
   writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_RXEN);
 
   // Code moved from pio_init
@@ -552,87 +787,716 @@ static uint8_t enc28j60_get_status( void )
 }
 #endif
 
+// ---------- checksum offload ----------
+
+/**
+ * Returns address in RX buffer, wrapped the same way as ERDPT does.
+ */
+static inline uint16_t rx_wrap(uint16_t addr)
+{
+  if(addr > s_uwRxStop)
+    addr -= s_uwRxStop + 1 - RXSTART_INIT;
+  return addr;
+}
+
+/**
+ * Adds big endian words to one's complement sum. Odd length is zero-padded.
+ */
+static uint32_t csum_add(uint32_t sum, const uint8_t *buf, uint8_t len)
+{
+  for(uint8_t i = 0; i < len; i += 2)
+    sum += (uint16_t)buf[i] << 8 | ((i + 1 < len) ? buf[i + 1] : 0);
+  return sum;
+}
+
+static uint16_t csum_fold(uint32_t sum)
+{
+  while(sum >> 16)
+    sum = (sum & 0xFFFF) + (sum >> 16);
+  return sum;
+}
+
+/**
+ * Sums buffer memory range with DMA checksum engine. Ranges starting in RX
+ * buffer wrap at its end.
+ * @return One's complement sum of range, not complemented yet.
+ */
+static uint16_t dma_sum(uint16_t start, uint16_t len)
+{
+	#ifdef NOENC
+	return 0;
+	#endif
+  uint16_t end = start + len - 1;
+  if(start <= s_uwRxStop)
+    end = rx_wrap(end);
+  writeReg(EDMAST, start);
+  writeReg(EDMAND, end);
+  writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_DMAST | ECON1_CSUMEN);
+  while(readOp(ENC28J60_READ_CTRL_REG, ECON1) & ECON1_DMAST);
+  // Chip gives complemented sum, with first byte of big endian word in EDMACSH
+  return ~(readRegByte(EDMACS + 1) << 8 | readRegByte(EDMACS));
+}
+
+/**
+ * Returns sum of TCP/UDP pseudo header.
+ * @param ip IPv4 header.
+ * @param len TCP/UDP segment length.
+ */
+static uint32_t csum_pseudo(const uint8_t *ip, uint16_t len)
+{
+  // Source and target addresses are adjacent
+  uint32_t sum = csum_add(0, ip_get_src_ip(ip), 8);
+  return sum + ip_get_protocol(ip) + len;
+}
+
+/**
+ * Checks if frame starts with IPv4 header which offload can deal with.
+ * @param frame Frame's first ETH_HDR_SIZE + IP_MIN_HDR_SIZE bytes.
+ * @param size Whole frame size.
+ * @return IP header length, 0 if frame is to be left alone.
+ */
+static uint8_t csum_ip_hdr_len(const uint8_t *frame, uint16_t size)
+{
+  if(size < ETH_HDR_SIZE + IP_MIN_HDR_SIZE || !eth_is_ipv4_pkt(frame))
+    return 0;
+  const uint8_t *ip = frame + ETH_HDR_SIZE;
+  uint8_t hdr_len = ip_get_hdr_length(ip);
+  uint16_t total = ip_get_total_length(ip);
+  if(
+    (ip[0] >> 4) != 4 || hdr_len < IP_MIN_HDR_SIZE || total < hdr_len ||
+    total > size - ETH_HDR_SIZE
+  ) {
+    return 0;
+  }
+  return hdr_len;
+}
+
+/**
+ * Returns offset of TCP/UDP checksum field in IPv4 payload, 0 if payload
+ * has no checksum which could be handled. Fragments are left alone, since
+ * their checksums cover whole datagram.
+ */
+static uint8_t csum_seg_offs(const uint8_t *ip)
+{
+  if(ip_is_fragment(ip))
+    return 0;
+  switch(ip_get_protocol(ip)) {
+    case IP_PROTOCOL_UDP:
+      return UDP_CHECKSUM_OFF;
+    case IP_PROTOCOL_TCP:
+      return TCP_CHECKSUM_OFF;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Fills IP and TCP/UDP checksums of IPv4 frame already written into TX slot.
+ * Checksum fields may hold anything, they're left out of sums.
+ * @param start TX slot address.
+ * @param data Frame, only its headers are read.
+ * @param size Frame size.
+ */
+static void tx_csum_fill(uint16_t start, const uint8_t *data, uint16_t size)
+{
+  uint8_t hdr_len = csum_ip_hdr_len(data, size);
+  if(!hdr_len)
+    return;
+  const uint8_t *ip = data + ETH_HDR_SIZE;
+  uint16_t ip_addr = start + 1 + ETH_HDR_SIZE;
+
+  // IP header is at hand, so it's quicker to sum it here than to use DMA
+  uint32_t sum = csum_add(0, ip, hdr_len);
+  sum += (uint16_t)~net_get_word(ip + IP_CHECKSUM_OFF);
+  writeBufWord(ip_addr + IP_CHECKSUM_OFF, ~csum_fold(sum));
+
+  uint8_t csum_offs = csum_seg_offs(ip);
+  uint16_t len = ip_get_total_length(ip) - hdr_len;
+  if(!csum_offs || len < csum_offs + 2)
+    return;
+  const uint8_t *seg = ip + hdr_len;
+  uint16_t seg_addr = ip_addr + hdr_len;
+  sum = csum_pseudo(ip, len) + dma_sum(seg_addr, len);
+  sum += (uint16_t)~net_get_word(seg + csum_offs);
+  uint16_t csum = ~csum_fold(sum);
+  if(!csum && csum_offs == UDP_CHECKSUM_OFF)
+    csum = 0xFFFF; // zero would mean there's no checksum at all
+  writeBufWord(seg_addr + csum_offs, csum);
+}
+
+/**
+ * Enables filling checksums of sent IPv4 frames and dropping received ones
+ * with bad checksums. Only TCP and UDP checksums are handled besides IP
+ * header one, other frames pass as they are.
+ * @param enable 1 to enable offload, 0 to disable it.
+ */
+void enc28j60_set_csum_offload(uint8_t enable)
+{
+  s_ubCsumOffload = enable;
+}
+
+// ---------- link ----------
+
+/**
+ * Reads PHY link state after LINKIF was seen in EIR, which also clears it.
+ * MII reads are slow, so they're done only then.
+ */
+static void link_update(void)
+{
+  readPhy(PHIR);
+  uint8_t up = (readPhyByte(PHSTAT2) >> 2) & 1;
+  if(up == g_ubEncLinkUp) {
+    if(up) {
+      // Went down and back up in the meantime
+      ++stats_link.downs;
+      stats_link.last_down = stats_link.last_up = g_uwTimeStamp;
+    }
+    return;
+  }
+  g_ubEncLinkUp = up;
+  s_ubLinkChanged = 1;
+  if(up)
+    stats_link.last_up = g_uwTimeStamp;
+  else {
+    ++stats_link.downs;
+    stats_link.last_down = g_uwTimeStamp;
+  }
+}
+
 // ---------- send ----------
 
+static inline uint16_t tx_slot_addr(uint8_t slot)
+{
+  return s_uwTxStart + slot * TX_SLOT_SIZE;
+}
+
+/**
+ * Resets TX logic, aborting frame being sent.
+ * See Rev. B7 Silicon Errata point 12.
+ */
+static void tx_reset(void)
+{
+  writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_TXRST);
+  writeOp(ENC28J60_BIT_FIELD_CLR, ECON1, ECON1_TXRST | ECON1_TXRTS);
+}
+
+/**
+ * Starts transmission of frame in head slot of TX ring.
+ */
+static void tx_start(void)
+{
+  uint16_t start = tx_slot_addr(s_ubTxHead);
+  writePtr(PTR_ETXST, start);
+  writePtr(PTR_ETXND, start + s_pTxSize[s_ubTxHead]);
+  writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_TXRTS);
+}
+
+/**
+ * Frees head slot of TX ring and starts next queued frame.
+ */
+static void tx_retire(void)
+{
+  s_ubTxHead = (s_ubTxHead + 1) % s_ubTxSlots;
+  --s_ubTxCount;
+  stats_tx_queue.depth = s_ubTxCount;
+  if(s_ubTxCount)
+    tx_start();
+}
+
+/**
+ * Frees slot of frame which has left the wire and starts next queued one.
+ * Must be called periodically, since frames are kicked off only here.
+ * Aborted frames aren't retried, they're only counted in stats.
+ * @return Number of frames still queued.
+ */
+uint8_t enc28j60_tx_poll(void)
+{
+	#ifdef NOENC
+	return 0;
+	#endif
+  if(!s_ubTxCount)
+    return 0;
+#ifdef ETH_INT
+  // Nothing has finished while ~INT is high
+  if(ETH_INT_PIN & ETH_INT)
+    return s_ubTxCount;
+#endif
+
+  uint8_t eir = readOp(ENC28J60_READ_CTRL_REG, EIR);
+  if(eir & EIR_LINKIF)
+    link_update();
+  if(!(eir & (EIR_TXIF | EIR_TXERIF)))
+    return s_ubTxCount;
+
+  if(eir & EIR_TXERIF) {
+    // Half duplex wire may have collided after slot time - frame is lost
+    uint8_t estat = readOp(ENC28J60_READ_CTRL_REG, ESTAT);
+    if(estat & ESTAT_LATECOL)
+      ++stats_tx_queue.late_cols;
+    tx_reset();
+    writeOp(ENC28J60_BIT_FIELD_CLR, ESTAT, ESTAT_TXABRT);
+    stats_get(STATS_ID_PIO_TX)->err++;
+  }
+  writeOp(ENC28J60_BIT_FIELD_CLR, EIR, EIR_TXIF | EIR_TXERIF);
+  tx_retire();
+  return s_ubTxCount;
+}
+
+/**
+ * Returns address of next free slot in TX ring.
+ * If all slots are taken, waits until head frame leaves the wire. If it
+ * doesn't within TX_SLOT_TIMEOUT, TX logic is reset and head frame dropped,
+ * so that bridge never hangs on stuck transmission.
+ */
+static uint16_t tx_slot_alloc(void)
+{
+  // Bridge loop may not have polled since last frame was done, e.g. in batch
+  if(enc28j60_tx_poll() == s_ubTxSlots) {
+    ++stats_tx_queue.stalls;
+    g_uwTimer100us = 0;
+    while(enc28j60_tx_poll() == s_ubTxSlots) {
+      if(g_uwTimer100us >= TX_SLOT_TIMEOUT) {
+        tx_reset();
+        writeOp(ENC28J60_BIT_FIELD_CLR, EIR, EIR_TXIF | EIR_TXERIF);
+        ++stats_tx_queue.drops;
+        stats_get(STATS_ID_PIO_TX)->drop++;
+        tx_retire();
+      }
+    }
+  }
+  return tx_slot_addr((s_ubTxHead + s_ubTxCount) % s_ubTxSlots);
+}
+
+/**
+ * Queues frame written into slot returned by tx_slot_alloc().
+ */
+static void tx_queue(uint16_t size)
+{
+  s_pTxSize[(s_ubTxHead + s_ubTxCount) % s_ubTxSlots] = size;
+  ++s_ubTxCount;
+  stats_tx_queue.depth = s_ubTxCount;
+  if(s_ubTxCount > stats_tx_queue.max_depth)
+    stats_tx_queue.max_depth = s_ubTxCount;
+  if(s_ubTxCount == 1)
+    tx_start();
+  spi_account_frame(1);
+}
+
 uint8_t enc28j60_send(const uint8_t *data, uint16_t size)
 {
 	#ifdef NOENC
 	return 0;
 	#endif
   // prepare tx buffer write
-  writeReg(EWRPT, TXSTART_INIT);
-  writeOp(ENC28J60_WRITE_BUF_MEM, 0, 0x00);
+  uint16_t start = tx_slot_alloc();
+  writePtr(PTR_EWRPT, start);
 
-  // fill buffer
-  uint16_t num = size;
-  spiEnableEth(),
+  // per packet control byte and frame go in single transaction
+  spi_account(2 + size);
+  spiEnableEth();
   spiWriteByte(ENC28J60_WRITE_BUF_MEM);
-  while(num--) {
-    spiWriteByte(*data++);
-  }
+  spiWriteByte(0x00);
+  spiWriteBlock(data, size);
   spiDisableEth();
-
-  // wait for tx ready
-  while (readOp(ENC28J60_READ_CTRL_REG, ECON1) & ECON1_TXRTS)
-      if (readRegByte(EIR) & EIR_TXERIF) {
-          writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_TXRST);
-          writeOp(ENC28J60_BIT_FIELD_CLR, ECON1, ECON1_TXRST);
-      }
+  s_pPtrValue[PTR_EWRPT] = start + 1 + size;
+  if(s_ubCsumOffload)
+    tx_csum_fill(start, data, size);
 
   // initiate send
-  writeReg(ETXND, TXSTART_INIT+size);
-  writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_TXRTS);
+  tx_queue(size);
+  return PIO_OK;
+}
+
+/**
+ * Starts writing frame straight into free slot of ENC28J60 TX ring.
+ * SPI is left selected with write buffer command issued, so caller may put
+ * frame bytes into SPDR. It must call enc28j60_send_stream_end() afterwards.
+ * Nothing gets sent until enc28j60_send_stream_commit() is called, so
+ * partially written frames are simply abandoned.
+ * @param hdr_room Bytes left free at frame start for Ethernet header, which
+ *        is known only once rest of frame is there. Whole header is written
+ *        on commit, so room may be short of it - bytes streamed in header's
+ *        place get overwritten.
+ */
+void enc28j60_send_stream_begin(uint8_t hdr_room)
+{
+	#ifdef NOENC
+	return;
+	#endif
+  uint16_t start = tx_slot_alloc();
+  s_ubTxStreamRoom = hdr_room;
+  if(hdr_room) {
+    // Control byte goes along with header
+    writePtr(PTR_EWRPT, start + 1 + hdr_room);
+    forgetPtr(PTR_EWRPT);
+    spi_account(1);
+    spiEnableEth();
+    spiWriteByte(ENC28J60_WRITE_BUF_MEM);
+    return;
+  }
+  writePtr(PTR_EWRPT, start);
+  // Caller may abandon frame anywhere, so EWRPT is settled on commit
+  forgetPtr(PTR_EWRPT);
+  spi_account(2);
+  spiEnableEth();
+  spiWriteByte(ENC28J60_WRITE_BUF_MEM);
+  spiWriteByte(0x00); // per packet control byte
+}
+
+/**
+ * Ends write started by enc28j60_send_stream_begin().
+ */
+void enc28j60_send_stream_end(void)
+{
+	#ifdef NOENC
+	return;
+	#endif
+  spiDisableEth();
+}
+
+/**
+ * Queues frame written by enc28j60_send_stream_begin() for sending.
+ * @param data Copy of streamed frame, needed for checksum offload. Also
+ *        source of Ethernet header if room was left for it.
+ * @param size Frame size.
+ * @return Always PIO_OK.
+ */
+uint8_t enc28j60_send_stream_commit(const uint8_t *data, uint16_t size)
+{
+	#ifdef NOENC
+	return 0;
+	#endif
+  spi_account_data(size);
+  uint16_t start = tx_slot_addr((s_ubTxHead + s_ubTxCount) % s_ubTxSlots);
+  if(s_ubTxStreamRoom) {
+    writePtr(PTR_EWRPT, start);
+    spi_account(2);
+    spiEnableEth();
+    spiWriteByte(ENC28J60_WRITE_BUF_MEM);
+    spiWriteByte(0x00); // per packet control byte
+    spiWriteBlock(data, ETH_HDR_SIZE);
+    spiDisableEth();
+    s_pPtrValue[PTR_EWRPT] = start + 1 + ETH_HDR_SIZE;
+  }
+  else
+    s_pPtrValue[PTR_EWRPT] = start + 1 + size;
+  s_ubPtrKnown |= _BV(PTR_EWRPT);
+  if(s_ubCsumOffload)
+    tx_csum_fill(start, data, size);
+  tx_queue(size);
   return PIO_OK;
 }
 
+/**
+ * Throws away all queued frames, e.g. when link is gone and they have nowhere
+ * to go. Flushed frames are counted as PIO_TX drops.
+ */
+static void tx_flush(void)
+{
+  // Retire head frame normally if it made it before link went away
+  if(!enc28j60_tx_poll())
+    return;
+  tx_reset();
+  writeOp(ENC28J60_BIT_FIELD_CLR, EIR, EIR_TXIF | EIR_TXERIF);
+  stats_get(STATS_ID_PIO_TX)->drop += s_ubTxCount;
+  s_ubTxCount = 0;
+  stats_tx_queue.depth = 0;
+}
+
+// ---------- link ----------
+
+/**
+ * Reports PHY link changes, so that Amiga can be told about them.
+ * LINKIF is picked up by EIR reads done anyway in tx_poll() and has_recv(),
+ * since bridge loop doesn't run during long batch transfers. Otherwise EIR
+ * is looked at once per 16 calls - or on each one while link is down, so
+ * that its return is seen quickly - only if ~INT is active when wired.
+ * LINKIF holds ~INT low, so that mustn't wait too long either. Call count is
+ * used instead of timer, since transfers keep resetting it.
+ * On link loss TX queue is flushed, so that its frames don't hold slots
+ * while going nowhere.
+ * @return 1 if link state has changed since last call, otherwise 0.
+ */
+uint8_t enc28j60_link_poll(void)
+{
+	#ifdef NOENC
+	return 0;
+	#endif
+  if(!s_ubLinkChanged) {
+    if((++s_ubLinkPollSkip & 15) && g_ubEncLinkUp)
+      return 0;
+#ifdef ETH_INT
+    if(ETH_INT_PIN & ETH_INT)
+      return 0;
+#endif
+    if(readOp(ENC28J60_READ_CTRL_REG, EIR) & EIR_LINKIF)
+      link_update();
+    if(!s_ubLinkChanged)
+      return 0;
+  }
+  s_ubLinkChanged = 0;
+  if(!g_ubEncLinkUp)
+    tx_flush();
+  return 1;
+}
+
 // ---------- recv ----------
 
+/**
+ * Throws away whole RX buffer content and restarts receive logic.
+ * Used when buffer is found corrupted, which may happen after overflows,
+ * so that frames are never read from garbage pointers.
+ */
+static void rx_reset(void)
+{
+	#ifdef NOENC
+	return;
+	#endif
+  writeOp(ENC28J60_BIT_FIELD_CLR, ECON1, ECON1_RXEN);
+
+  // Pending frames are lost - count them while clearing EPKTCNT
+  uint8_t lost = 0;
+  while(readRegByte(EPKTCNT)) {
+    writeOp(ENC28J60_BIT_FIELD_SET, ECON2, ECON2_PKTDEC);
+    ++lost;
+  }
+  stats_get(STATS_ID_PIO_RX)->drop += lost;
+  ++stats_rx_buf.resets;
+
+  writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_RXRST);
+  writeOp(ENC28J60_BIT_FIELD_CLR, ECON1, ECON1_RXRST);
+  // Writing ERXST moves ERXWRPT there, ERXRDPT must be odd (silicon errata)
+  writeReg(ERXST, RXSTART_INIT);
+  writeReg(ERXRDPT, s_uwRxStop);
+  gNextPacketPtr = RXSTART_INIT;
+  s_ubRxPending = 0;
+  s_uwRxWinLen = 0;
+  forgetPtr(PTR_ERDPT);
+  writeOp(ENC28J60_BIT_FIELD_CLR, EIR, EIR_RXERIF);
+  writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_RXEN);
+}
+
+/**
+ * Handles RX error and link change flags.
+ * RX buffer overflows can only happen while frames are pending and RXERIF
+ * stays set until it's seen, so looking once per consumed frame keeps count
+ * of overflow events accurate without polling while idle.
+ */
+static void rx_check_eir(void)
+{
+  uint8_t eir = readOp(ENC28J60_READ_CTRL_REG, EIR);
+  if(eir & EIR_LINKIF)
+    link_update();
+  if(eir & EIR_RXERIF) {
+    // Frames which didn't fit were rejected, ones already stored are fine
+    writeOp(ENC28J60_BIT_FIELD_CLR, EIR, EIR_RXERIF);
+    ++stats_rx_buf.overflows;
+    stats_get(STATS_ID_PIO_RX)->drop++;
+  }
+}
+
 inline static void next_pkt(void)
 {
 	#ifdef NOENC
 	return;
 	#endif
-  if (gNextPacketPtr - 1 > RXSTOP_INIT)
-      writeReg(ERXRDPT, RXSTOP_INIT);
+  rx_check_eir();
+  if ((uint16_t)(gNextPacketPtr - 1) > s_uwRxStop)
+      writeReg(ERXRDPT, s_uwRxStop);
   else
       writeReg(ERXRDPT, gNextPacketPtr - 1);
   writeOp(ENC28J60_BIT_FIELD_SET, ECON2, ECON2_PKTDEC);
+  if(s_ubRxPending)
+    --s_ubRxPending;
+  s_uwRxWinLen = 0;
+  spi_account_frame(0);
 }
 
-static uint8_t read_hdr(uint16_t *got_size)
+/**
+ * Follows ERDPT auto-increment, which wraps at the end of RX buffer.
+ */
+static void rx_ptr_advance(uint16_t len)
+{
+  s_pPtrValue[PTR_ERDPT] = rx_wrap(s_pPtrValue[PTR_ERDPT] + len);
+}
+
+/**
+ * Reads big endian word from RX buffer.
+ */
+static uint16_t readBufWord(uint16_t addr)
 {
 	#ifdef NOENC
 	return 0;
 	#endif
-  struct {
-		uint16_t nextPacket;
-		uint16_t byteCount;
-		uint16_t status;
-  } header;
+  uint8_t buf[2];
+  writePtr(PTR_ERDPT, addr);
+  spi_account(3);
+  spiEnableEth();
+  spiWriteByte(ENC28J60_READ_BUF_MEM);
+  readBufData(2, buf);
+  spiDisableEth();
+  rx_ptr_advance(2);
+  return net_get_word(buf);
+}
 
-  readBuf(sizeof header, (uint8_t*) &header);
+/**
+ * Checks IP and TCP/UDP checksums of received frame.
+ * Must be called within read buffer transaction positioned at frame's first
+ * byte - it gets ended here.
+ * @param start Frame address in RX buffer.
+ * @param size Frame size.
+ * @return 1 if frame may be passed to Amiga, 0 if it has bad checksum.
+ */
+static uint8_t rx_csum_ok(uint16_t start, uint16_t size)
+{
+  uint8_t frame[ETH_HDR_SIZE + IP_MIN_HDR_SIZE];
+  uint8_t hdr_len = 0;
+  if(size >= sizeof frame) {
+    readBufData(sizeof frame, frame);
+    rx_ptr_advance(sizeof frame);
+    hdr_len = csum_ip_hdr_len(frame, size);
+  }
+  spiDisableEth();
+  if(!hdr_len)
+    return 1;
+
+  // Valid headers sum up to 0xFFFF along with their checksums
+  const uint8_t *ip = frame + ETH_HDR_SIZE;
+  uint16_t ip_addr = rx_wrap(start + ETH_HDR_SIZE);
+  uint16_t sum = (hdr_len == IP_MIN_HDR_SIZE) ?
+    csum_fold(csum_add(0, ip, hdr_len)) : dma_sum(ip_addr, hdr_len);
+  if(sum != 0xFFFF)
+    return 0;
+
+  uint8_t csum_offs = csum_seg_offs(ip);
+  uint16_t len = ip_get_total_length(ip) - hdr_len;
+  if(!csum_offs || len < csum_offs + 2)
+    return 1;
+  uint16_t seg_addr = rx_wrap(ip_addr + hdr_len);
+  if(csum_fold(csum_pseudo(ip, len) + dma_sum(seg_addr, len)) == 0xFFFF)
+    return 1;
+
+  // UDP checksum is optional - field is fetched only now, since it's rarely 0
+  return csum_offs == UDP_CHECKSUM_OFF &&
+    !readBufWord(rx_wrap(seg_addr + csum_offs));
+}
 
-  gNextPacketPtr  = header.nextPacket;
-  *got_size = header.byteCount - 4; //remove the CRC count
-  return header.status;
+/**
+ * Receive status vector preceding each frame in RX buffer.
+ */
+typedef struct {
+  uint16_t nextPacket;
+  uint16_t byteCount; // with CRC
+  uint16_t status;
+} rx_hdr_t;
+
+/**
+ * Checks if header read from RX buffer makes sense - otherwise buffer is
+ * corrupted and must be reset, since frames can't be found any more.
+ */
+static uint8_t rx_hdr_valid(const rx_hdr_t *header)
+{
+  // Chip keeps frames at even addresses within RX buffer
+  return header->nextPacket <= s_uwRxStop && !(header->nextPacket & 1) &&
+    header->byteCount <= MAX_FRAMELEN && header->byteCount >= 4;
 }
 
-uint8_t enc28j60_recv(uint8_t *data, uint16_t max_size, uint16_t *got_size)
+/**
+ * Reads header of next received frame. On success SPI is left selected
+ * with read buffer command issued, so payload may follow in same transaction.
+ * If enc28j60_set_rx_window() was called, read starts at window instead.
+ * @param got_size Frame size without CRC, or window size.
+ * @return PIO_OK on success, PIO_IO_ERR if frame was dropped due to RX error,
+ *         PIO_DROPPED if checksum offload found it broken.
+ */
+static uint8_t read_hdr(uint16_t *got_size)
 {
 	#ifdef NOENC
 	return 0;
 	#endif
-  writeReg(ERDPT, gNextPacketPtr);
+  rx_hdr_t header;
 
-  // read chip's packet header
-  uint8_t status = read_hdr(got_size);
+  writePtr(PTR_ERDPT, gNextPacketPtr);
+  spi_account(1);
+  spiEnableEth();
+  spiWriteByte(ENC28J60_READ_BUF_MEM);
+  readBufData(sizeof header, (uint8_t*) &header);
+  rx_ptr_advance(sizeof header);
+
+  if(!rx_hdr_valid(&header)) {
+    spiDisableEth();
+    rx_reset();
+    return PIO_IO_ERR;
+  }
+
+  gNextPacketPtr  = header.nextPacket;
+  *got_size = header.byteCount - 4; //remove the CRC count
 
   // was a receive error?
-  if ((status & 0x80)==0) {
+  if ((header.status & 0x80)==0) {
+    spiDisableEth();
     next_pkt();
     return PIO_IO_ERR;
   }
 
+  uint16_t start = s_pPtrValue[PTR_ERDPT];
+  uint8_t seek = 0;
+  if(s_ubCsumOffload) {
+    if(!rx_csum_ok(start, *got_size)) {
+      next_pkt();
+      return PIO_DROPPED;
+    }
+    // Rewind to frame's first byte
+    seek = 1;
+  }
+  if(s_uwRxWinLen) {
+    uint8_t skip = (s_ubRxWinSkip < *got_size) ? s_ubRxWinSkip : *got_size;
+    *got_size -= skip;
+    if(*got_size > s_uwRxWinLen)
+      *got_size = s_uwRxWinLen;
+    if(s_ubRxWinLeadSet) {
+      // Lead byte takes place of last byte skipped, or of RX header's last
+      // one, which is already read
+      start = (skip || start != RXSTART_INIT) ?
+        rx_wrap(start + skip - 1) : s_uwRxStop;
+      if(!seek)
+        spiDisableEth();
+      writePtr(PTR_EWRPT, start);
+      spi_account(2);
+      spiEnableEth();
+      spiWriteByte(ENC28J60_WRITE_BUF_MEM);
+      spiWriteByte(s_ubRxWinLead);
+      spiDisableEth();
+      s_pPtrValue[PTR_EWRPT] = start + 1;
+      ++*got_size;
+      seek = 1;
+    }
+    else if(skip) {
+      start = rx_wrap(start + skip);
+      if(!seek)
+        spiDisableEth();
+      seek = 1;
+    }
+  }
+  if(seek) {
+    writePtr(PTR_ERDPT, start);
+    spi_account(1);
+    spiEnableEth();
+    spiWriteByte(ENC28J60_READ_BUF_MEM);
+  }
+  return PIO_OK;
+}
+
+uint8_t enc28j60_recv(uint8_t *data, uint16_t max_size, uint16_t *got_size)
+{
+	#ifdef NOENC
+	return 0;
+	#endif
+  // read chip's packet header
+  uint8_t hdr_result = read_hdr(got_size);
+  if(hdr_result != PIO_OK)
+    return hdr_result;
+
   // check size
   uint16_t len = *got_size;
   uint8_t result = PIO_OK;
@@ -642,20 +1506,289 @@ uint8_t enc28j60_recv(uint8_t *data, uint16_t max_size, uint16_t *got_size)
   }
 
   // read packet
-  readBuf(len, data);
+  readBufData(len, data);
+  spiDisableEth();
+  rx_ptr_advance(len);
 
   next_pkt();
   return result;
 }
 
+/**
+ * Starts reading received frame straight from ENC28J60 buffer memory.
+ * On success SPI is left selected with read buffer command issued, so caller
+ * may clock frame bytes out of SPDR. It must call enc28j60_recv_stream_end()
+ * afterwards, even if it didn't read whole frame.
+ * @param got_size Frame size, without CRC.
+ * @return PIO_OK on success, error of read_hdr() if frame was dropped.
+ */
+uint8_t enc28j60_recv_stream_begin(uint16_t *got_size)
+{
+	#ifdef NOENC
+	return 0;
+	#endif
+  // read chip's packet header
+  uint8_t hdr_result = read_hdr(got_size);
+  if(hdr_result != PIO_OK)
+    return hdr_result;
+
+  // Caller reads on its own and may stop anywhere
+  forgetPtr(PTR_ERDPT);
+  spi_account_data(*got_size);
+  return PIO_OK;
+}
+
+/**
+ * Ends read started by enc28j60_recv_stream_begin() and frees frame's space.
+ */
+void enc28j60_recv_stream_end(void)
+{
+	#ifdef NOENC
+	return;
+	#endif
+  spiDisableEth();
+  next_pkt();
+}
+
+// ---------- peek ----------
+
+/**
+ * Finds header of index-th pending frame, following next packet pointers.
+ * @param index Frame index, 0 being next one to be received.
+ * @param header Filled with frame's header.
+ * @param addr Filled with header's address.
+ * @return PIO_OK on success, PIO_NOT_FOUND if there are not that many frames,
+ *         PIO_IO_ERR if RX buffer turned out corrupted - it's reset then.
+ */
+static uint8_t rx_find(uint8_t index, rx_hdr_t *header, uint16_t *addr)
+{
+  // Cached count is a lower bound, so it's refreshed only if too low
+  if(index >= s_ubRxPending) {
+    s_ubRxPending = readRegByte(EPKTCNT);
+    if(index >= s_ubRxPending)
+      return PIO_NOT_FOUND;
+  }
+
+  *addr = gNextPacketPtr;
+  for(;;) {
+    writePtr(PTR_ERDPT, *addr);
+    spi_account(1);
+    spiEnableEth();
+    spiWriteByte(ENC28J60_READ_BUF_MEM);
+    readBufData(sizeof *header, (uint8_t*)header);
+    spiDisableEth();
+    rx_ptr_advance(sizeof *header);
+    if(!rx_hdr_valid(header)) {
+      rx_reset();
+      return PIO_IO_ERR;
+    }
+    if(!index--)
+      return PIO_OK;
+    *addr = header->nextPacket;
+  }
+}
+
+/**
+ * Reads part of pending frame without taking it out of ENC28J60, so that it
+ * can be classified for tens of SPI bytes instead of whole frame.
+ * @param index Frame index, 0 being one which enc28j60_recv() would return.
+ * @param offs Offset of first byte to read.
+ * @param data Buffer for read bytes.
+ * @param len Byte count, trimmed so that it doesn't exceed frame.
+ * @param got_size If not zero, filled with frame size, without CRC.
+ * @return PIO_OK on success, PIO_NOT_FOUND if there are not that many frames,
+ *         PIO_IO_ERR if frame was received with error or RX buffer was found
+ *         corrupted.
+ */
+uint8_t enc28j60_peek(
+  uint8_t index, uint16_t offs, uint8_t *data, uint16_t len, uint16_t *got_size
+)
+{
+	#ifdef NOENC
+	return PIO_NOT_FOUND;
+	#endif
+  rx_hdr_t header;
+  uint16_t addr;
+  uint8_t result = rx_find(index, &header, &addr);
+  if(result != PIO_OK)
+    return result;
+  if(!(header.status & 0x80))
+    return PIO_IO_ERR;
+
+  uint16_t size = header.byteCount - 4;
+  if(got_size)
+    *got_size = size;
+  if(offs >= size || !len)
+    return PIO_OK;
+  if(len > size - offs)
+    len = size - offs;
+
+  writePtr(PTR_ERDPT, rx_wrap(addr + sizeof header + offs));
+  spi_account(1);
+  spiEnableEth();
+  spiWriteByte(ENC28J60_READ_BUF_MEM);
+  readBufData(len, data);
+  spiDisableEth();
+  rx_ptr_advance(len);
+  return PIO_OK;
+}
+
+/**
+ * Frees space of next pending frame without reading its content.
+ * Frame isn't counted in stats, that's up to caller.
+ * @return PIO_OK on success, PIO_NOT_FOUND if there is no frame,
+ *         PIO_IO_ERR if RX buffer was found corrupted and got reset.
+ */
+uint8_t enc28j60_drop(void)
+{
+	#ifdef NOENC
+	return PIO_NOT_FOUND;
+	#endif
+  rx_hdr_t header;
+  uint16_t addr;
+  uint8_t result = rx_find(0, &header, &addr);
+  if(result != PIO_OK)
+    return result;
+  gNextPacketPtr = header.nextPacket;
+  next_pkt();
+  return PIO_OK;
+}
+
+/**
+ * Makes next enc28j60_recv() or enc28j60_recv_stream_begin() return only
+ * part of next pending frame, e.g. without headers or padding which needn't
+ * cross parallel port. Window is forgotten once frame is taken out of buffer.
+ * @param skip Bytes left out at frame start.
+ * @param len Bytes returned after them at most, must not be 0.
+ */
+void enc28j60_set_rx_window(uint8_t skip, uint16_t len)
+{
+  s_ubRxWinSkip = skip;
+  s_uwRxWinLen = len;
+  s_ubRxWinLeadSet = 0;
+}
+
+/**
+ * Makes window set by enc28j60_set_rx_window() start with given byte, e.g.
+ * tag which replaces skipped header. Byte is put into RX buffer right before
+ * window, so it costs just one SPI transaction. Call it after setting window.
+ * @param lead Byte handed out before window, counted in its size.
+ */
+void enc28j60_set_rx_lead(uint8_t lead)
+{
+  s_ubRxWinLead = lead;
+  s_ubRxWinLeadSet = 1;
+}
+
+// ---------- bounce ----------
+
+/**
+ * Sends next pending frame back to the wire with its header rewritten, then
+ * frees it from RX buffer. Rest of frame is copied into TX slot by DMA, so
+ * only new header crosses SPI - meant for replies made out of requests.
+ * @param hdr New content of frame's first hdr_len bytes.
+ * @param hdr_len New header length.
+ * @param size Bytes to send, Ethernet padding of received frame may be cut.
+ * @param csum_start Offset of first byte covered by checksum.
+ * @param csum_offs Offset of checksum field, 0 if there's none. Field gets
+ *        filled with checksum of bytes from csum_start up to size, so it must
+ *        be zeroed in hdr.
+ * @return PIO_OK on success, PIO_NOT_FOUND if there is no frame,
+ *         PIO_TOO_LARGE if size exceeds it, PIO_IO_ERR if it was received
+ *         with error or RX buffer was found corrupted.
+ */
+uint8_t enc28j60_bounce(
+  const uint8_t *hdr, uint8_t hdr_len, uint16_t size,
+  uint8_t csum_start, uint8_t csum_offs
+)
+{
+	#ifdef NOENC
+	return PIO_NOT_FOUND;
+	#endif
+  rx_hdr_t header;
+  uint16_t addr;
+  uint8_t result = rx_find(0, &header, &addr);
+  if(result != PIO_OK)
+    return result;
+  if(!(header.status & 0x80))
+    return PIO_IO_ERR;
+  if(size > header.byteCount - 4 || size < hdr_len)
+    return PIO_TOO_LARGE;
+
+  uint16_t start = tx_slot_alloc();
+  if(size > hdr_len) {
+    // DMA copy wraps at the end of RX buffer just like checksum does
+    uint16_t frame = rx_wrap(addr + sizeof header);
+    writeReg(EDMAST, rx_wrap(frame + hdr_len));
+    writeReg(EDMAND, rx_wrap(frame + size - 1));
+    writeReg(EDMADST, start + 1 + hdr_len);
+    writeOp(ENC28J60_BIT_FIELD_CLR, ECON1, ECON1_CSUMEN);
+    writeOp(ENC28J60_BIT_FIELD_SET, ECON1, ECON1_DMAST);
+    while(readOp(ENC28J60_READ_CTRL_REG, ECON1) & ECON1_DMAST);
+  }
+
+  // per packet control byte and header go in single transaction
+  writePtr(PTR_EWRPT, start);
+  spi_account(2 + hdr_len);
+  spiEnableEth();
+  spiWriteByte(ENC28J60_WRITE_BUF_MEM);
+  spiWriteByte(0x00);
+  spiWriteBlock(hdr, hdr_len);
+  spiDisableEth();
+  s_pPtrValue[PTR_EWRPT] = start + 1 + hdr_len;
+  if(csum_offs) {
+    uint16_t sum = dma_sum(start + 1 + csum_start, size - csum_start);
+    writeBufWord(start + 1 + csum_offs, ~sum);
+  }
+
+  gNextPacketPtr = header.nextPacket;
+  next_pkt();
+  tx_queue(size);
+  return PIO_OK;
+}
+
 // ---------- has_recv ----------
 
+/**
+ * Returns number of received frames waiting in ENC28J60 buffer.
+ * EPKTCNT is only decremented by next_pkt(), so last value read from it,
+ * lowered by each consumed frame, is still a safe lower bound. Chip is asked
+ * again only when that count drops to zero.
+ * If ~INT is wired, asserted line is a fast path, but idle one isn't trusted
+ * for long: PKTIF is unreliable (Rev. B7 Silicon Errata point 6), so EPKTCNT
+ * is still read on every 16th call, like link_poll() does with EIR.
+ * RX buffer overflows are checked by next_pkt(), see rx_check_eir().
+ * @return Frame count - may be lower than EPKTCNT, but never zero if it's not.
+ */
 uint8_t enc28j60_has_recv(void)
 {
 	#ifdef NOENC
 	return 0;
 	#endif
-  return readRegByte(EPKTCNT);
+  if(s_ubRxPending)
+    return s_ubRxPending;
+#ifdef ETH_INT
+  // ~INT is level-triggered and held low while PKTIF is set
+  if((ETH_INT_PIN & ETH_INT) && (++s_ubRxPollSkip & 15)) {
+    spi_account_idle();
+    return 0;
+  }
+#endif
+  s_ubRxPending = readRegByte(EPKTCNT);
+  if(!s_ubRxPending)
+    spi_account_idle();
+  else {
+    // Fill level costs two register reads, so it's sampled only on new peaks
+    if(s_ubRxPending > stats_rx_buf.peak_frames) {
+      stats_rx_buf.peak_frames = s_ubRxPending;
+      uint16_t fill = readReg(ERXWRPT) - gNextPacketPtr;
+      if(fill > s_uwRxStop)
+        fill += s_uwRxStop + 1 - RXSTART_INIT;
+      if(fill > stats_rx_buf.peak_fill)
+        stats_rx_buf.peak_fill = fill;
+    }
+  }
+  return s_ubRxPending;
 }
 
 #if 0
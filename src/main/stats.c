@@ -10,6 +10,11 @@
 #include <main/base/uart.h>
 
 stats_t stats[STATS_ID_NUM];
+stats_tx_queue_t stats_tx_queue;
+stats_rx_buf_t stats_rx_buf;
+stats_link_t stats_link;
+stats_spi_t stats_spi;
+stats_offload_t stats_offload;
 
 void stats_reset(void)
 {
@@ -21,6 +26,25 @@ void stats_reset(void)
     s->drop = 0;
     s->max_rate = 0;
   }
+  stats_tx_queue.stalls = 0;
+  stats_tx_queue.late_cols = 0;
+  stats_tx_queue.drops = 0;
+  stats_tx_queue.max_depth = stats_tx_queue.depth;
+  stats_rx_buf.overflows = 0;
+  stats_rx_buf.resets = 0;
+  stats_rx_buf.peak_fill = 0;
+  stats_rx_buf.peak_frames = 0;
+  // Flap time stamps are kept, they're meaningful without counts
+  stats_link.downs = 0;
+  stats_spi.rx_bytes = 0;
+  stats_spi.rx_selects = 0;
+  stats_spi.tx_bytes = 0;
+  stats_spi.tx_selects = 0;
+  stats_offload.arp_replies = 0;
+  stats_offload.echo_replies = 0;
+  stats_offload.arp_requests = 0;
+  stats_offload.hdrc_rx = 0;
+  stats_offload.hdrc_tx = 0;
 }
 
 void stats_update_ok(uint8_t id, uint16_t size, uint16_t rate)
@@ -56,6 +56,11 @@ void configDisplay(tConfig *pConfig) {
 		pConfig->test_ip[0], pConfig->test_ip[1],
 		pConfig->test_ip[2], pConfig->test_ip[3]
 	);
+	printf("Burst delay: %hu loops\n", pConfig->burst_delay);
+	printf(
+		"TX slots: %hu%s\n", pConfig->tx_slots,
+		(pConfig->tx_slots < 1 || pConfig->tx_slots > 4) ? " (board default)" : ""
+	);
 }
 
 int main(int lArgCount, char **pArgs) {
@@ -106,6 +111,11 @@ int main(int lArgCount, char **pArgs) {
 						}
 						++i;
 					}
+					else if(!strcmp(pArgs[i], "txslots") && i + 1 != lArgCount) {
+						// Board falls back to default if it's out of 1..4 range
+						sConfig.tx_slots = atoi(pArgs[i+1]);
+						++i;
+					}
 				}
 				if(!ubErr)
 					cmdConfigSet(&sConfig, ubWriteType);